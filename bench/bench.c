@@ -0,0 +1,366 @@
+#include "../src/regex.h"
+#include <time.h>
+
+// bench.out OUTPUT [BASELINE] writes the results as json to OUTPUT and, with
+// a baseline, fails when a result is worse than the baseline by more than
+// its threshold. times and throughputs depend on the machine, so a baseline
+// is only meaningful on the machine that wrote it, while memory is the same
+// everywhere.
+
+#define BENCH_MAX_RESULTS 64
+#define BENCH_NAME_LEN 64
+#define BENCH_INPUT_LEN (1 << 20)
+#define BENCH_MIN_NS 200000000.0
+#define BENCH_THRESHOLD 0.3
+
+typedef struct bench_result {
+  char name[BENCH_NAME_LEN];
+  const char *unit;
+  double value;
+} bench_result;
+
+typedef struct bench_results {
+  int len;
+  double threshold;
+  bench_result items[BENCH_MAX_RESULTS];
+} bench_results;
+
+static double now_ns() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void add_result(bench_results *results, const char *name,
+                       const char *unit, double value) {
+  if (results->len == BENCH_MAX_RESULTS)
+    return;
+
+  bench_result *r = &results->items[results->len++];
+  snprintf(r->name, sizeof(r->name), "%s", name);
+  r->unit = unit;
+  r->value = value;
+
+  printf("%-32s %14.1f %s\n", name, value, unit);
+}
+
+// branches words of the form a0, a1, ... joined by |.
+static char *new_alternation(int branches) {
+  char *pattern = (char *)malloc(branches * 8 + 1);
+  int len = 0;
+
+  for (int i = 0; i < branches; i++)
+    len += sprintf(pattern + len, i == 0 ? "a%i" : "|a%i", i);
+
+  return pattern;
+}
+
+// a starred under depth groups, then b, like (((a)*)*)*b.
+static char *new_nesting(int depth) {
+  char *pattern = (char *)malloc(depth * 3 + 3);
+  int len = 0;
+
+  for (int i = 0; i < depth; i++)
+    pattern[len++] = '(';
+
+  pattern[len++] = 'a';
+
+  for (int i = 0; i < depth; i++) {
+    pattern[len++] = ')';
+    pattern[len++] = '*';
+  }
+
+  pattern[len++] = 'b';
+  pattern[len] = '\0';
+
+  return pattern;
+}
+
+// compile time is the mean over as many compiles as fit the time budget,
+// memory is what the compiled regex holds.
+static void bench_compile(bench_results *results, const char *kind,
+                          const char *pattern, int size) {
+  char name[BENCH_NAME_LEN];
+  int runs = 0;
+  double start = now_ns();
+  double elapsed = 0;
+  regex_alloc_stats stats;
+
+  stats.compile_bytes_reserved = 0;
+
+  while (elapsed < BENCH_MIN_NS / 4) {
+    regex *r = regex_compile(pattern);
+
+    if (r == NULL) {
+      printf("Could not compile '%s'\n", pattern);
+      return;
+    }
+
+    regex_get_alloc_stats(r, &stats);
+    regex_free(r);
+
+    runs++;
+    elapsed = now_ns() - start;
+  }
+
+  snprintf(name, sizeof(name), "compile/%s_%i", kind, size);
+  add_result(results, name, "ns", elapsed / runs);
+
+  snprintf(name, sizeof(name), "memory/%s_%i", kind, size);
+  add_result(results, name, "bytes", stats.compile_bytes_reserved);
+}
+
+// throughput of the fastest run, which is the one least disturbed by the
+// rest of the machine.
+static void bench_match(bench_results *results, const char *name,
+                        const char *pattern, const char *str, int str_len,
+                        int search) {
+  regex *r = regex_compile(pattern);
+
+  if (r == NULL) {
+    printf("Could not compile '%s'\n", pattern);
+    return;
+  }
+
+  double best = 0;
+  double start = now_ns();
+
+  while (now_ns() - start < BENCH_MIN_NS) {
+    int match_start;
+    int match_end;
+    double run_start = now_ns();
+
+    if (search)
+      regex_search(r, str, str_len, &match_start, &match_end);
+    else
+      regex_match(r, str, str_len);
+
+    double run = now_ns() - run_start;
+
+    if (best == 0 || run < best)
+      best = run;
+  }
+
+  regex_free(r);
+  add_result(results, name, "MB/s", str_len / (best / 1e9) / (1 << 20));
+}
+
+static void run_benches(bench_results *results) {
+  int sizes[4] = {4, 32, 256, 1024};
+
+  for (int i = 0; i < 4; i++) {
+    char *alternation = new_alternation(sizes[i]);
+    char *nesting = new_nesting(sizes[i]);
+
+    bench_compile(results, "alternation", alternation, sizes[i]);
+    bench_compile(results, "nesting", nesting, sizes[i]);
+
+    free(nesting);
+    free(alternation);
+  }
+
+  char *str = (char *)malloc(BENCH_INPUT_LEN);
+
+  for (int i = 0; i < BENCH_INPUT_LEN; i++)
+    str[i] = ((i * 2654435761u) >> 13) & 1 ? 'a' : 'b';
+
+  memcpy(str + BENCH_INPUT_LEN - 3, "abb", 3);
+  bench_match(results, "match/ab_suffix", "(a|b)*abb", str, BENCH_INPUT_LEN,
+              0);
+
+  // pathological for backtracking matchers, a long run of a before the b.
+  memset(str, 'a', BENCH_INPUT_LEN);
+  str[BENCH_INPUT_LEN - 1] = 'b';
+  bench_match(results, "match/nested_star", "(a*)*b", str, BENCH_INPUT_LEN,
+              0);
+
+  char *nesting = new_nesting(32);
+  bench_match(results, "match/deep_nesting", nesting, str, BENCH_INPUT_LEN, 0);
+  free(nesting);
+
+  // words of a long alternation, one after another.
+  char *alternation = new_alternation(256);
+  int alternation_len = strlen(alternation);
+  char *words = (char *)malloc(alternation_len + 4);
+  snprintf(words, alternation_len + 4, "(%s)*", alternation);
+
+  int len = 0;
+
+  for (int i = 0; len < BENCH_INPUT_LEN - 8; i = (i * 7 + 3) % 256)
+    len += sprintf(str + len, "a%i", i);
+
+  bench_match(results, "match/long_alternation", words, str, len, 0);
+
+  // text with a literal match only at its end.
+  for (int i = 0; i < BENCH_INPUT_LEN; i++)
+    str[i] = "xyzw"[i % 4];
+
+  memcpy(str + BENCH_INPUT_LEN - 8, "abcdedef", 8);
+  bench_match(results, "search/literal_at_end", "abc(d|e)*f", str,
+              BENCH_INPUT_LEN, 1);
+  bench_match(results, "search/long_alternation_miss", alternation, str,
+              BENCH_INPUT_LEN, 1);
+
+  free(words);
+  free(alternation);
+  free(str);
+}
+
+static int write_results(const bench_results *results, const char *path) {
+  FILE *out = fopen(path, "w");
+
+  if (out == NULL)
+    return -1;
+
+  fprintf(out, "{\n  \"threshold\": %.2f,\n  \"results\": [\n",
+          results->threshold);
+
+  for (int i = 0; i < results->len; i++) {
+    const bench_result *r = &results->items[i];
+
+    fprintf(out,
+            "    {\"name\": \"%s\", \"unit\": \"%s\", \"value\": %.1f}%s\n",
+            r->name, r->unit, r->value, i + 1 < results->len ? "," : "");
+  }
+
+  fprintf(out, "  ]\n}\n");
+
+  return fclose(out) == 0 ? 0 : -1;
+}
+
+// reads back what write_results wrote, every name followed by its value.
+static int read_results(bench_results *results, const char *path) {
+  FILE *in = fopen(path, "r");
+
+  if (in == NULL)
+    return -1;
+
+  fseek(in, 0, SEEK_END);
+  long size = ftell(in);
+  fseek(in, 0, SEEK_SET);
+
+  char *json = (char *)malloc(size + 1);
+
+  if (json == NULL || fread(json, 1, size, in) != (size_t)size) {
+    free(json);
+    fclose(in);
+    return -1;
+  }
+
+  json[size] = '\0';
+  fclose(in);
+
+  results->len = 0;
+  results->threshold = BENCH_THRESHOLD;
+
+  char *threshold = strstr(json, "\"threshold\":");
+
+  if (threshold != NULL)
+    results->threshold = strtod(threshold + strlen("\"threshold\":"), NULL);
+
+  char *p = json;
+
+  while ((p = strstr(p, "\"name\": \"")) != NULL &&
+         results->len < BENCH_MAX_RESULTS) {
+    bench_result *r = &results->items[results->len];
+    p += strlen("\"name\": \"");
+
+    char *name_end = strchr(p, '"');
+    char *value = strstr(p, "\"value\":");
+
+    if (name_end == NULL || value == NULL ||
+        name_end - p >= BENCH_NAME_LEN) {
+      free(json);
+      return -1;
+    }
+
+    memcpy(r->name, p, name_end - p);
+    r->name[name_end - p] = '\0';
+    r->unit = NULL;
+    r->value = strtod(value + strlen("\"value\":"), NULL);
+    results->len++;
+    p = value;
+  }
+
+  free(json);
+  return 0;
+}
+
+// throughputs regress when they drop, times and memory when they grow.
+static int compare_results(const bench_results *results,
+                           const bench_results *baseline) {
+  int regressions = 0;
+
+  printf("\nComparing with the baseline, threshold %.0f%%:\n",
+         baseline->threshold * 100);
+
+  for (int i = 0; i < results->len; i++) {
+    const bench_result *r = &results->items[i];
+    const bench_result *b = NULL;
+
+    for (int k = 0; k < baseline->len && b == NULL; k++) {
+      if (strcmp(baseline->items[k].name, r->name) == 0)
+        b = &baseline->items[k];
+    }
+
+    if (b == NULL || b->value <= 0) {
+      printf("%-32s no baseline\n", r->name);
+      continue;
+    }
+
+    double change = (r->value - b->value) / b->value;
+    int higher_is_better = strcmp(r->unit, "MB/s") == 0;
+    int regressed = higher_is_better ? change < -baseline->threshold
+                                     : change > baseline->threshold;
+
+    printf("%-32s %+7.1f%%%s\n", r->name, change * 100,
+           regressed ? "  regressed" : "");
+
+    regressions += regressed;
+  }
+
+  return regressions;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2 && argc != 3) {
+    printf("Usage: %s OUTPUT [BASELINE]\n", argv[0]);
+    return -1;
+  }
+
+  bench_results results;
+  results.len = 0;
+  results.threshold = BENCH_THRESHOLD;
+
+  bench_results baseline;
+
+  if (argc == 3) {
+    if (read_results(&baseline, argv[2]) == -1) {
+      printf("Could not read the baseline '%s'\n", argv[2]);
+      return -1;
+    }
+
+    results.threshold = baseline.threshold;
+  }
+
+  printf("Running benchmarks...\n");
+  run_benches(&results);
+
+  if (write_results(&results, argv[1]) == -1) {
+    printf("Could not write '%s'\n", argv[1]);
+    return -1;
+  }
+
+  if (argc == 3) {
+    int regressions = compare_results(&results, &baseline);
+
+    if (regressions > 0) {
+      printf("%i benchmarks regressed\n", regressions);
+      return -1;
+    }
+
+    printf("No benchmark regressed\n");
+  }
+
+  return 0;
+}
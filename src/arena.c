@@ -0,0 +1,115 @@
+#include "arena.h"
+
+#define ARENA_HEADER_SIZE ARENA_ALIGN_UP(sizeof(arena))
+#define ARENA_BLOCK_HEADER_SIZE ARENA_ALIGN_UP(sizeof(arena_block))
+
+arena *new_arena(size_t block_size) {
+  block_size = ARENA_ALIGN_UP(block_size);
+
+  // the first block shares the allocation of the arena itself.
+  arena *a = (arena *)malloc(ARENA_HEADER_SIZE + ARENA_BLOCK_HEADER_SIZE +
+                             block_size);
+
+  if (a == NULL)
+    return NULL;
+
+  a->head = (arena_block *)((char *)a + ARENA_HEADER_SIZE);
+  a->head->next = NULL;
+  a->head->size = block_size;
+  a->head->used = 0;
+  a->curr = a->head;
+  a->block_size = block_size;
+  a->heap_allocations = 1;
+  a->bytes_reserved = block_size;
+
+  return a;
+}
+
+void free_arena(arena *a) {
+  if (a == NULL)
+    return;
+
+  arena_block *b = a->head->next;
+
+  while (b != NULL) {
+    arena_block *next = b->next;
+    free(b);
+    b = next;
+  }
+
+  free(a);
+}
+
+void *arena_alloc(arena *a, size_t size) {
+  if (a == NULL)
+    return malloc(size);
+
+  size = ARENA_ALIGN_UP(size);
+
+  arena_block *b = a->curr;
+
+  if (b->size - b->used < size) {
+    // reuse the blocks kept from before the last reset when they are big
+    // enough, otherwise a new block goes right after the current one.
+    if (b->next != NULL && b->next->size >= size) {
+      b = b->next;
+      b->used = 0;
+    } else {
+      size_t block_size = size > a->block_size ? size : a->block_size;
+      arena_block *nb =
+          (arena_block *)malloc(ARENA_BLOCK_HEADER_SIZE + block_size);
+
+      if (nb == NULL)
+        return NULL;
+
+      nb->next = b->next;
+      nb->size = block_size;
+      nb->used = 0;
+      b->next = nb;
+      b = nb;
+
+      a->heap_allocations++;
+      a->bytes_reserved += block_size;
+    }
+
+    a->curr = b;
+  }
+
+  void *ptr = (char *)b + ARENA_BLOCK_HEADER_SIZE + b->used;
+  b->used += size;
+
+  return ptr;
+}
+
+void arena_release(arena *a, void *ptr) {
+  if (a == NULL)
+    free(ptr);
+}
+
+void arena_reset(arena *a) {
+  a->curr = a->head;
+  a->head->used = 0;
+}
+
+arena_mark arena_save(arena *a) {
+  arena_mark mark;
+
+  if (a == NULL) {
+    mark.block = NULL;
+    mark.used = 0;
+    return mark;
+  }
+
+  mark.block = a->curr;
+  mark.used = a->curr->used;
+
+  return mark;
+}
+
+void arena_restore(arena *a, arena_mark mark) {
+  if (a == NULL)
+    return;
+
+  a->curr = mark.block;
+  a->curr->used = mark.used;
+}
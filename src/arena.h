@@ -0,0 +1,41 @@
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_ALIGN_UP(size)                                                   \
+  (((size) + (ARENA_ALIGNMENT - 1)) & ~((size_t)ARENA_ALIGNMENT - 1))
+
+// a block is followed by its data. blocks are kept after a reset, so an arena
+// that has seen its largest workload once does not touch the heap anymore.
+typedef struct arena_block {
+  struct arena_block *next;
+  size_t size;
+  size_t used;
+} arena_block;
+
+typedef struct arena {
+  arena_block *head;
+  arena_block *curr;
+  size_t block_size;
+  int heap_allocations;
+  size_t bytes_reserved;
+} arena;
+
+typedef struct arena_mark {
+  arena_block *block;
+  size_t used;
+} arena_mark;
+
+arena *new_arena(size_t block_size);
+void free_arena(arena *a);
+
+void *arena_alloc(arena *a, size_t size);
+void arena_release(arena *a, void *ptr);
+void arena_reset(arena *a);
+arena_mark arena_save(arena *a);
+void arena_restore(arena *a, arena_mark mark);
+
+#endif
@@ -0,0 +1,107 @@
+#include "batch.h"
+#include <unistd.h>
+
+static void *run_batch_worker(void *arg) {
+  batch_worker *w = (batch_worker *)arg;
+
+  for (;;) {
+    int block = __atomic_fetch_add(w->next_block, 1, __ATOMIC_RELAXED);
+    int from = block * BATCH_BLOCK_SIZE;
+
+    if (from >= w->count)
+      break;
+
+    int to = from + BATCH_BLOCK_SIZE < w->count ? from + BATCH_BLOCK_SIZE
+                                                 : w->count;
+
+    for (int i = from; i < to; i++) {
+      int evaluated =
+          regex_match_with(w->context, w->inputs[i].str, w->inputs[i].len);
+
+      if (evaluated == 1) {
+        w->results[i / 8] |= 1 << (i % 8);
+        w->matches++;
+      } else if (evaluated != 0) {
+        w->failed = 1;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+int regex_match_batch(const regex *r, const regex_input *inputs, int count,
+                      unsigned char *results, int threads) {
+  if (r == NULL || inputs == NULL || results == NULL || count < 0)
+    return -1;
+
+  if (threads <= 0)
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  // a worker without a block of its own would only cost its setup.
+  int blocks = (count + BATCH_BLOCK_SIZE - 1) / BATCH_BLOCK_SIZE;
+
+  if (threads > blocks)
+    threads = blocks;
+
+  if (threads > BATCH_MAX_THREADS)
+    threads = BATCH_MAX_THREADS;
+
+  if (threads < 1)
+    threads = 1;
+
+  memset(results, 0, (count + 7) / 8);
+
+  batch_worker workers[BATCH_MAX_THREADS];
+  int next_block = 0;
+  int started = 1;
+  int failed = 0;
+
+  for (int i = 0; i < threads; i++) {
+    batch_worker *w = &workers[i];
+
+    w->r = r;
+    w->inputs = inputs;
+    w->count = count;
+    w->results = results;
+    w->next_block = &next_block;
+    w->matches = 0;
+    w->failed = 0;
+    w->context = NULL;
+  }
+
+  workers[0].context = regex_borrow_context(r);
+
+  if (workers[0].context == NULL)
+    return -1;
+
+  // a worker that can not be set up or started leaves its blocks to the
+  // others.
+  for (; started < threads; started++) {
+    batch_worker *w = &workers[started];
+
+    w->context = regex_borrow_context(r);
+
+    if (w->context == NULL ||
+        pthread_create(&w->thread, NULL, run_batch_worker, w) != 0) {
+      regex_return_context(r, w->context);
+      break;
+    }
+  }
+
+  run_batch_worker(&workers[0]);
+
+  int matches = workers[0].matches;
+  failed = workers[0].failed;
+
+  for (int i = 1; i < started; i++) {
+    pthread_join(workers[i].thread, NULL);
+    matches += workers[i].matches;
+    failed |= workers[i].failed;
+    regex_return_context(r, workers[i].context);
+  }
+
+  regex_return_context(r, workers[0].context);
+
+  return failed ? -1 : matches;
+}
@@ -0,0 +1,40 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include "arena.h"
+#include "dfa.h"
+#include "regex.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// inputs are handed out in blocks of BATCH_BLOCK_SIZE, a multiple of eight,
+// so no two workers ever write the same byte of the result bitmap.
+#define BATCH_BLOCK_SIZE 256
+#define BATCH_MAX_THREADS 256
+
+typedef struct regex_input {
+  const char *str;
+  int len;
+} regex_input;
+
+// every worker, the calling thread as worker 0 too, borrows a match context
+// from the regex's pool for the batch, since that is the only part of a
+// match that changes.
+typedef struct batch_worker {
+  const regex *r;
+  const regex_input *inputs;
+  int count;
+  unsigned char *results;
+  int *next_block;
+  int matches;
+  int failed;
+  regex_match_context *context;
+  pthread_t thread;
+} batch_worker;
+
+int regex_match_batch(const regex *r, const regex_input *inputs, int count,
+                      unsigned char *results, int threads);
+
+#endif
@@ -0,0 +1,345 @@
+#include "cache.h"
+
+static regex_cache *global_cache = NULL;
+static pthread_once_t global_cache_once = PTHREAD_ONCE_INIT;
+
+static unsigned int hash_pattern(const char *pattern) {
+  unsigned int h = 2166136261u;
+
+  for (const char *p = pattern; *p != '\0'; p++) {
+    h ^= (unsigned char)*p;
+    h *= 16777619u;
+  }
+
+  return h;
+}
+
+// drops a reference to r and returns r when it was the last one, for the
+// caller to free once the lock is released, otherwise NULL.
+static regex *unref_regex(regex *r) {
+  return --r->runtime->cache_refs == 0 ? r : NULL;
+}
+
+static void reset_regex_cache_tables(regex_cache *c) {
+  c->len = 0;
+  c->head = REGEX_CACHE_NO_ENTRY;
+  c->tail = REGEX_CACHE_NO_ENTRY;
+  c->free = c->capacity > 0 ? 0 : REGEX_CACHE_NO_ENTRY;
+
+  for (int i = 0; i <= c->table_mask; i++)
+    c->table[i] = REGEX_CACHE_NO_ENTRY;
+
+  for (int i = 0; i < c->capacity; i++)
+    c->entries[i].next = i + 1 < c->capacity ? i + 1 : REGEX_CACHE_NO_ENTRY;
+}
+
+// the tables live in an arena of their own, so a new capacity only has to
+// swap the arena.
+static int new_regex_cache_tables(regex_cache *c, int capacity) {
+  int table_len = 2;
+
+  while (table_len < capacity * 2)
+    table_len *= 2;
+
+  int entries_len = capacity > 0 ? capacity : 1;
+  arena *mem = new_arena(sizeof(regex_cache_entry) * entries_len +
+                         sizeof(int) * table_len + ARENA_ALIGNMENT * 2);
+
+  if (mem == NULL)
+    return -1;
+
+  c->entries = (regex_cache_entry *)arena_alloc(
+      mem, sizeof(regex_cache_entry) * entries_len);
+  c->table = (int *)arena_alloc(mem, sizeof(int) * table_len);
+  c->table_mask = table_len - 1;
+  c->capacity = capacity;
+  c->mem = mem;
+
+  reset_regex_cache_tables(c);
+
+  return 0;
+}
+
+static int find_regex_cache_entry(regex_cache *c, const char *pattern,
+                                  unsigned int hash) {
+  int i = c->table[hash & c->table_mask];
+
+  while (i != REGEX_CACHE_NO_ENTRY) {
+    regex_cache_entry *e = &c->entries[i];
+
+    if (e->hash == hash && strcmp(e->r->pattern, pattern) == 0)
+      return i;
+
+    i = e->chain;
+  }
+
+  return REGEX_CACHE_NO_ENTRY;
+}
+
+static void unlink_regex_cache_entry(regex_cache *c, int i) {
+  regex_cache_entry *e = &c->entries[i];
+
+  if (e->prev != REGEX_CACHE_NO_ENTRY)
+    c->entries[e->prev].next = e->next;
+  else
+    c->head = e->next;
+
+  if (e->next != REGEX_CACHE_NO_ENTRY)
+    c->entries[e->next].prev = e->prev;
+  else
+    c->tail = e->prev;
+
+  int *link = &c->table[e->hash & c->table_mask];
+
+  while (*link != i)
+    link = &c->entries[*link].chain;
+
+  *link = e->chain;
+
+  e->r = NULL;
+  e->next = c->free;
+  c->free = i;
+  c->len--;
+}
+
+static void link_regex_cache_entry(regex_cache *c, regex *r,
+                                   unsigned int hash) {
+  int i = c->free;
+  regex_cache_entry *e = &c->entries[i];
+  int *bucket = &c->table[hash & c->table_mask];
+
+  c->free = e->next;
+
+  e->r = r;
+  e->hash = hash;
+  e->prev = REGEX_CACHE_NO_ENTRY;
+  e->next = c->head;
+  e->chain = *bucket;
+  *bucket = i;
+
+  if (c->head != REGEX_CACHE_NO_ENTRY)
+    c->entries[c->head].prev = i;
+  else
+    c->tail = i;
+
+  c->head = i;
+  c->len++;
+}
+
+// the entry becomes the most recently used one.
+static void touch_regex_cache_entry(regex_cache *c, int i) {
+  regex_cache_entry *e = &c->entries[i];
+
+  if (c->head == i)
+    return;
+
+  c->entries[e->prev].next = e->next;
+
+  if (e->next != REGEX_CACHE_NO_ENTRY)
+    c->entries[e->next].prev = e->prev;
+  else
+    c->tail = e->prev;
+
+  e->prev = REGEX_CACHE_NO_ENTRY;
+  e->next = c->head;
+  c->entries[c->head].prev = i;
+  c->head = i;
+}
+
+regex_cache *new_regex_cache(int capacity) {
+  if (capacity < 0)
+    return NULL;
+
+  regex_cache *c = (regex_cache *)malloc(sizeof(regex_cache));
+
+  if (c == NULL)
+    return NULL;
+
+  if (new_regex_cache_tables(c, capacity) == -1) {
+    free(c);
+    return NULL;
+  }
+
+  memset(&c->stats, 0, sizeof(c->stats));
+  pthread_mutex_init(&c->lock, NULL);
+
+  return c;
+}
+
+void free_regex_cache(regex_cache *c) {
+  if (c == NULL)
+    return;
+
+  for (int i = c->head; i != REGEX_CACHE_NO_ENTRY; i = c->entries[i].next)
+    regex_free(unref_regex(c->entries[i].r));
+
+  pthread_mutex_destroy(&c->lock);
+  free_arena(c->mem);
+  free(c);
+}
+
+// the pattern is compiled without the lock held, so a caller of another
+// pattern is not kept waiting. when a caller of the same pattern cached it
+// in the meantime, that regex is shared and the new one freed.
+const regex *regex_cache_acquire(regex_cache *c, const char *pattern,
+                                 int *err) {
+  if (c == NULL || pattern == NULL)
+    return regex_compile_with_options(pattern, NULL, err);
+
+  unsigned int hash = hash_pattern(pattern);
+
+  pthread_mutex_lock(&c->lock);
+
+  int i = find_regex_cache_entry(c, pattern, hash);
+
+  if (i != REGEX_CACHE_NO_ENTRY) {
+    regex *r = c->entries[i].r;
+
+    r->runtime->cache_refs++;
+    touch_regex_cache_entry(c, i);
+    c->stats.hits++;
+    pthread_mutex_unlock(&c->lock);
+
+    if (err != NULL)
+      *err = REGEX_OK;
+
+    return r;
+  }
+
+  c->stats.misses++;
+  pthread_mutex_unlock(&c->lock);
+
+  regex *r = regex_compile_with_options(pattern, NULL, err);
+
+  if (r == NULL)
+    return NULL;
+
+  regex *unused = NULL;
+  regex *evicted = NULL;
+
+  pthread_mutex_lock(&c->lock);
+
+  i = find_regex_cache_entry(c, pattern, hash);
+
+  if (i != REGEX_CACHE_NO_ENTRY) {
+    unused = r;
+    r = c->entries[i].r;
+    r->runtime->cache_refs++;
+    touch_regex_cache_entry(c, i);
+  } else if (c->capacity == 0) {
+    r->runtime->cache_refs = 1;
+  } else {
+    if (c->len == c->capacity) {
+      evicted = unref_regex(c->entries[c->tail].r);
+      unlink_regex_cache_entry(c, c->tail);
+      c->stats.evictions++;
+    }
+
+    r->runtime->cache_refs = 2;
+    link_regex_cache_entry(c, r, hash);
+  }
+
+  pthread_mutex_unlock(&c->lock);
+
+  regex_free(unused);
+  regex_free(evicted);
+
+  return r;
+}
+
+// a regex that is no longer cached is freed with its last reference.
+void regex_cache_release(regex_cache *c, const regex *r) {
+  if (r == NULL)
+    return;
+
+  if (c == NULL) {
+    regex_free((regex *)r);
+    return;
+  }
+
+  pthread_mutex_lock(&c->lock);
+  regex *last = unref_regex((regex *)r);
+  pthread_mutex_unlock(&c->lock);
+
+  regex_free(last);
+}
+
+// the most recently used regexes that fit the new capacity are moved to the
+// new tables in their order, the others are evicted.
+int regex_cache_set_capacity(regex_cache *c, int capacity) {
+  if (c == NULL || capacity < 0)
+    return -1;
+
+  pthread_mutex_lock(&c->lock);
+
+  regex_cache_entry *entries = c->entries;
+  int head = c->head;
+  arena *mem = c->mem;
+
+  if (new_regex_cache_tables(c, capacity) == -1) {
+    pthread_mutex_unlock(&c->lock);
+    return -1;
+  }
+
+  int last = REGEX_CACHE_NO_ENTRY;
+  int i = head;
+
+  for (int k = 0; k < capacity && i != REGEX_CACHE_NO_ENTRY; k++) {
+    last = i;
+    i = entries[i].next;
+  }
+
+  for (; i != REGEX_CACHE_NO_ENTRY; i = entries[i].next) {
+    regex_free(unref_regex(entries[i].r));
+    c->stats.evictions++;
+  }
+
+  for (i = last; i != REGEX_CACHE_NO_ENTRY; i = entries[i].prev)
+    link_regex_cache_entry(c, entries[i].r, entries[i].hash);
+
+  free_arena(mem);
+  pthread_mutex_unlock(&c->lock);
+
+  return 0;
+}
+
+void regex_cache_clear(regex_cache *c) {
+  if (c == NULL)
+    return;
+
+  pthread_mutex_lock(&c->lock);
+
+  for (int i = c->head; i != REGEX_CACHE_NO_ENTRY; i = c->entries[i].next)
+    regex_free(unref_regex(c->entries[i].r));
+
+  reset_regex_cache_tables(c);
+  pthread_mutex_unlock(&c->lock);
+}
+
+void regex_cache_get_stats(regex_cache *c, regex_cache_stats *stats) {
+  pthread_mutex_lock(&c->lock);
+
+  *stats = c->stats;
+  stats->capacity = c->capacity;
+  stats->len = c->len;
+
+  pthread_mutex_unlock(&c->lock);
+}
+
+static void free_global_regex_cache() {
+  free_regex_cache(global_cache);
+  global_cache = NULL;
+}
+
+static void new_global_regex_cache() {
+  global_cache = new_regex_cache(REGEX_CACHE_DEFAULT_CAPACITY);
+
+  if (global_cache != NULL)
+    atexit(free_global_regex_cache);
+}
+
+regex_cache *regex_cache_global() {
+  pthread_once(&global_cache_once, new_global_regex_cache);
+
+  return global_cache;
+}
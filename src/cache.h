@@ -0,0 +1,69 @@
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include "arena.h"
+#include "regex.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REGEX_CACHE_DEFAULT_CAPACITY 64
+#define REGEX_CACHE_NO_ENTRY -1
+
+typedef struct regex_cache_stats {
+  int capacity;
+  int len;
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+} regex_cache_stats;
+
+// a compiled regex kept under its pattern text. entries are linked from the
+// most recently acquired one at head to the least recently acquired one at
+// tail, and chained per hash bucket through chain.
+typedef struct regex_cache_entry {
+  regex *r;
+  unsigned int hash;
+  int prev;
+  int next;
+  int chain;
+} regex_cache_entry;
+
+// a cache of at most capacity compiled regexes, evicting the least recently
+// used one. regex_cache_acquire hands out a reference to the cached regex,
+// compiling it on a miss, and regex_cache_release gives it back. since a
+// compiled regex can be matched from many threads at once, every caller of
+// a pattern shares the one regex, which is freed once it is evicted and the
+// last reference to it is given back. the lock only covers the tables and
+// the reference counts. unused entries are linked from free through next.
+// every regex acquired has to be released before the cache is freed.
+typedef struct regex_cache {
+  int capacity;
+  int len;
+  int head;
+  int tail;
+  int free;
+  int table_mask;
+  int *table;
+  regex_cache_entry *entries;
+  regex_cache_stats stats;
+  pthread_mutex_t lock;
+  arena *mem;
+} regex_cache;
+
+regex_cache *new_regex_cache(int capacity);
+void free_regex_cache(regex_cache *c);
+const regex *regex_cache_acquire(regex_cache *c, const char *pattern,
+                                 int *err);
+void regex_cache_release(regex_cache *c, const regex *r);
+int regex_cache_set_capacity(regex_cache *c, int capacity);
+void regex_cache_clear(regex_cache *c);
+void regex_cache_get_stats(regex_cache *c, regex_cache_stats *stats);
+
+// the cache evaluate_string compiles its patterns through, created on the
+// first call and freed when the process exits. NULL when it could not be
+// created.
+regex_cache *regex_cache_global();
+
+#endif
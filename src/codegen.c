@@ -0,0 +1,130 @@
+#include "codegen.h"
+
+static int is_identifier(const char *name) {
+  if (name == NULL || !(name[0] == '_' || (name[0] >= 'a' && name[0] <= 'z') ||
+                        (name[0] >= 'A' && name[0] <= 'Z')))
+    return 0;
+
+  for (const char *c = name + 1; *c != '\0'; c++) {
+    if (!(*c == '_' || is_nfa_symbol(*c)))
+      return 0;
+  }
+
+  return 1;
+}
+
+static void write_dfa_state(FILE *out, const dfa *d, int s,
+                            const char *targeted) {
+  int classes_len = d->number_of_classes;
+  const int *row = d->transitions + (size_t)s * classes_len;
+  int live = 0;
+
+  for (int k = 0; k < classes_len; k++)
+    live |= row[k] != d->dead;
+
+  if (targeted[s])
+    fprintf(out, "s%i:\n", s);
+
+  if (!live) {
+    fprintf(out, "  return %s;\n", d->accepting[s] ? "p == end" : "0");
+    return;
+  }
+
+  fprintf(out, "  if (p == end)\n    return %i;\n\n", d->accepting[s] ? 1 : 0);
+  fprintf(out, "  switch (*p++) {\n");
+
+  // the bytes of a class all go to the same state, so they share one goto.
+  for (int k = 0; k < classes_len; k++) {
+    if (row[k] == d->dead)
+      continue;
+
+    for (int c = 0; c < NFA_ALPHABET_SIZE; c++) {
+      if (d->byte_classes[c] != k)
+        continue;
+
+      if (is_nfa_symbol(c))
+        fprintf(out, "  case '%c':\n", c);
+      else
+        fprintf(out, "  case %i:\n", c);
+    }
+
+    fprintf(out, "    goto s%i;\n", row[k]);
+  }
+
+  fprintf(out, "  default:\n    return 0;\n  }\n");
+}
+
+// the initial state comes first, so the function starts in it without a
+// jump, and only states some transition goes to get a label.
+int write_dfa_matcher(FILE *out, const dfa *d, const char *name,
+                      const char *pattern) {
+  if (out == NULL || d == NULL || !is_identifier(name))
+    return -1;
+
+  char *targeted = (char *)calloc(d->number_of_states, 1);
+
+  if (targeted == NULL)
+    return -1;
+
+  for (size_t i = 0;
+       i < (size_t)d->number_of_states * d->number_of_classes; i++)
+    targeted[d->transitions[i]] = 1;
+
+  if (pattern != NULL)
+    fprintf(out, "// matches '%s'.\n", pattern);
+
+  fprintf(out, "int %s(const char *str, int str_len) {\n", name);
+  fprintf(out, "  const unsigned char *p = (const unsigned char *)str;\n");
+  fprintf(out, "  const unsigned char *end = p + str_len;\n\n");
+
+  write_dfa_state(out, d, d->init, targeted);
+
+  for (int s = 0; s < d->number_of_states; s++) {
+    if (s == d->init || s == d->dead)
+      continue;
+
+    fprintf(out, "\n");
+    write_dfa_state(out, d, s, targeted);
+  }
+
+  fprintf(out, "}\n");
+  free(targeted);
+
+  return ferror(out) ? -1 : 0;
+}
+
+int write_regex_matchers(FILE *out, const char **names, const char **patterns,
+                         int count, const regex_options *options,
+                         int *failed) {
+  if (failed != NULL)
+    *failed = -1;
+
+  regex_options full;
+  memset(&full, 0, sizeof(full));
+
+  if (options != NULL)
+    full = *options;
+
+  full.full_dfa = 1;
+
+  fprintf(out, "// generated by generate_matchers, do not edit.\n");
+
+  for (int i = 0; i < count; i++) {
+    regex *r = regex_compile_with_options(patterns[i], &full, NULL);
+
+    fprintf(out, "\n");
+
+    if (r == NULL ||
+        write_dfa_matcher(out, r->full, names[i], patterns[i]) == -1) {
+      if (failed != NULL)
+        *failed = i;
+
+      regex_free(r);
+      return -1;
+    }
+
+    regex_free(r);
+  }
+
+  return 0;
+}
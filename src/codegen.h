@@ -0,0 +1,22 @@
+#ifndef CODEGEN_H_
+#define CODEGEN_H_
+
+#include "dfa.h"
+#include "regex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// write_dfa_matcher writes a c function int name(const char *str, int
+// str_len) that runs d as a direct coded state machine, one label per state
+// and one switch over the next byte in each, so there are no tables left to
+// read. write_regex_matchers compiles every pattern to a minimized dfa and
+// writes one such function for each, named after names. failed is the index
+// of the pattern that could not be compiled, or -1.
+int write_dfa_matcher(FILE *out, const dfa *d, const char *name,
+                      const char *pattern);
+int write_regex_matchers(FILE *out, const char **names, const char **patterns,
+                         int count, const regex_options *options,
+                         int *failed);
+
+#endif
@@ -0,0 +1,76 @@
+#include "dfa_file.h"
+
+// compiles the patterns of a rules file, one per line, into a dfa file that
+// can be mapped with open_dfa_file. empty lines are skipped.
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    printf("Usage: %s RULES OUTPUT\n", argv[0]);
+    return -1;
+  }
+
+  FILE *in = fopen(argv[1], "r");
+
+  if (in == NULL) {
+    printf("Could not open '%s'\n", argv[1]);
+    return -1;
+  }
+
+  int count = 0;
+  int max = 64;
+  char **patterns = (char **)malloc(sizeof(char *) * max);
+  char *line = NULL;
+  size_t line_max = 0;
+  ssize_t len;
+
+  while (patterns != NULL && (len = getline(&line, &line_max, in)) != -1) {
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+      line[--len] = '\0';
+
+    if (len == 0)
+      continue;
+
+    if (count == max) {
+      max *= 2;
+      char **grown = (char **)realloc(patterns, sizeof(char *) * max);
+
+      if (grown == NULL) {
+        for (int i = 0; i < count; i++)
+          free(patterns[i]);
+
+        free(patterns);
+        patterns = NULL;
+        break;
+      }
+
+      patterns = grown;
+    }
+
+    patterns[count++] = strdup(line);
+  }
+
+  free(line);
+  fclose(in);
+
+  if (patterns == NULL) {
+    printf("Ran out of memory reading '%s'\n", argv[1]);
+    return -1;
+  }
+
+  int failed;
+  int written = write_dfa_file(argv[2], (const char **)patterns, count, NULL,
+                               &failed);
+
+  if (written == -1 && failed != -1)
+    printf("Could not compile rule %i '%s'\n", failed + 1, patterns[failed]);
+  else if (written == -1)
+    printf("Could not write '%s'\n", argv[2]);
+  else
+    printf("Wrote %i rules to '%s'\n", count, argv[2]);
+
+  for (int i = 0; i < count; i++)
+    free(patterns[i]);
+
+  free(patterns);
+
+  return written;
+}
@@ -0,0 +1,829 @@
+#include "dfa.h"
+
+static int compare_states(const void *a, const void *b) {
+  return *(const int *)a - *(const int *)b;
+}
+
+static unsigned int hash_set(const int *set, int set_len) {
+  unsigned int h = 2166136261u;
+
+  for (int i = 0; i < set_len; i++) {
+    h ^= (unsigned int)set[i];
+    h *= 16777619u;
+  }
+
+  return h;
+}
+
+lazy_dfa *new_lazy_dfa(nfa *n, size_t memory_limit, int unanchored) {
+  size_t state_size = sizeof(int) * n->number_of_classes +
+                      sizeof(lazy_dfa_state) + sizeof(int) * 2;
+
+  // three quarters of the budget go to states and their transitions, the
+  // rest to the nfa state sets behind them.
+  size_t max_states = memory_limit / 4 * 3 / state_size;
+  size_t sets_max = memory_limit / 4 / sizeof(int);
+
+  if (max_states < 4)
+    max_states = 4;
+
+  if (sets_max < (size_t)(n->number_of_states + 1) * 4)
+    sets_max = (size_t)(n->number_of_states + 1) * 4;
+
+  size_t table_len = 1;
+
+  while (table_len < max_states * 2)
+    table_len <<= 1;
+
+  size_t size = sizeof(lazy_dfa) + max_states * state_size +
+                sets_max * sizeof(int) + table_len * sizeof(int) +
+                n->number_of_states * sizeof(int) * 2 + 256;
+
+  arena *mem = new_arena(size);
+
+  if (mem == NULL)
+    return NULL;
+
+  lazy_dfa *d = (lazy_dfa *)arena_alloc(mem, sizeof(lazy_dfa));
+
+  if (d == NULL) {
+    free_arena(mem);
+    return NULL;
+  }
+
+  d->n = n;
+  d->unanchored = unanchored;
+  d->number_of_classes = n->number_of_classes;
+  d->max_states = max_states;
+  d->sets_max = sets_max;
+  d->table_mask = table_len - 1;
+  d->flushes = 0;
+  memset(&d->stats, 0, sizeof(d->stats));
+  d->mem = mem;
+  d->transitions = (int *)arena_alloc(mem, sizeof(int) * d->number_of_classes *
+                                               max_states);
+  d->states =
+      (lazy_dfa_state *)arena_alloc(mem, sizeof(lazy_dfa_state) * max_states);
+  d->sets = (int *)arena_alloc(mem, sizeof(int) * sets_max);
+  d->table = (int *)arena_alloc(mem, sizeof(int) * table_len);
+  d->target = new_sparse_set(n->number_of_states, mem);
+
+  int closures_len;
+  const int *closures = get_epsilon_closures(n, n->init, &closures_len);
+
+  d->init_set = (int *)arena_alloc(mem, sizeof(int) * (closures_len + 1));
+  d->init_set_len = closures_len;
+
+  if (d->transitions == NULL || d->states == NULL || d->sets == NULL ||
+      d->table == NULL || d->target == NULL || d->init_set == NULL) {
+    free_arena(mem);
+    return NULL;
+  }
+
+  memcpy(d->init_set, closures, sizeof(int) * closures_len);
+  qsort(d->init_set, closures_len, sizeof(int), compare_states);
+
+  lazy_dfa_flush(d);
+  d->flushes = 0;
+
+  if (d->init == DFA_UNKNOWN_STATE) {
+    free_arena(mem);
+    return NULL;
+  }
+
+  return d;
+}
+
+void free_lazy_dfa(lazy_dfa *d) {
+  if (d == NULL)
+    return;
+
+  free_arena(d->mem);
+}
+
+void lazy_dfa_flush(lazy_dfa *d) {
+  d->number_of_states = 0;
+  d->sets_len = 0;
+  d->flushes++;
+
+  for (int i = 0; i <= d->table_mask; i++)
+    d->table[i] = DFA_UNKNOWN_STATE;
+
+  // the dead state and the initial state are always the first two, so their
+  // ids survive a flush.
+  d->dead = lazy_dfa_add_state(d, NULL, 0);
+  d->init = lazy_dfa_add_state(d, d->init_set, d->init_set_len);
+}
+
+int lazy_dfa_add_state(lazy_dfa *d, const int *set, int set_len) {
+  unsigned int h = hash_set(set, set_len);
+  int slot = h & d->table_mask;
+
+  while (d->table[slot] != DFA_UNKNOWN_STATE) {
+    lazy_dfa_state *state = &d->states[d->table[slot]];
+
+    if (state->hash == h && state->set_len == set_len &&
+        memcmp(d->sets + state->set_offset, set, sizeof(int) * set_len) == 0)
+      return d->table[slot];
+
+    slot = (slot + 1) & d->table_mask;
+  }
+
+  if (d->number_of_states == d->max_states ||
+      d->sets_len + set_len > d->sets_max)
+    return DFA_UNKNOWN_STATE;
+
+  int id = d->number_of_states++;
+  lazy_dfa_state *state = &d->states[id];
+
+  state->set_offset = d->sets_len;
+  state->set_len = set_len;
+  state->hash = h;
+  state->accepting = 0;
+
+  for (int i = 0; i < set_len; i++) {
+    if (is_nfa_final(d->n, set[i]))
+      state->accepting = 1;
+  }
+
+  // the dead state has no nfa states and may come with a NULL set.
+  if (set_len > 0)
+    memcpy(d->sets + d->sets_len, set, sizeof(int) * set_len);
+
+  d->sets_len += set_len;
+  d->table[slot] = id;
+
+  REGEX_STATS_ONLY(d->stats.states++;)
+
+  // the dead state only leads to itself, every other transition is found
+  // the first time it is taken.
+  int *transitions = d->transitions + (size_t)id * d->number_of_classes;
+  int fill = set_len == 0 ? id : DFA_UNKNOWN_STATE;
+
+  for (int i = 0; i < d->number_of_classes; i++)
+    transitions[i] = fill;
+
+  return id;
+}
+
+int lazy_dfa_next_state(lazy_dfa *d, int s, unsigned char c) {
+  nfa *n = d->n;
+  lazy_dfa_state *state = &d->states[s];
+  const int *set = d->sets + state->set_offset;
+
+  sparse_set_clear(d->target);
+
+  for (int i = 0; i < state->set_len; i++) {
+    nfa_state *from = &n->states[set[i]];
+
+    if (from->symbol == '\0' || (unsigned char)from->symbol != c)
+      continue;
+
+    int closures_len;
+    const int *closures = get_epsilon_closures(n, from->next, &closures_len);
+
+    for (int j = 0; j < closures_len; j++)
+      sparse_set_add(d->target, closures[j]);
+
+    REGEX_STATS_ONLY(d->stats.closures++;)
+  }
+
+  // an unanchored dfa starts a new match after every byte.
+  if (d->unanchored) {
+    for (int i = 0; i < d->init_set_len; i++)
+      sparse_set_add(d->target, d->init_set[i]);
+  }
+
+  REGEX_STATS_ONLY({
+    d->stats.dfa_cache_misses++;
+
+    if (d->target->len > d->stats.queue_high_water)
+      d->stats.queue_high_water = d->target->len;
+  })
+
+  qsort(d->target->dense, d->target->len, sizeof(int), compare_states);
+
+  int t = lazy_dfa_add_state(d, d->target->dense, d->target->len);
+
+  if (t != DFA_UNKNOWN_STATE) {
+    d->transitions[(size_t)s * d->number_of_classes + n->byte_classes[c]] = t;
+    return t;
+  }
+
+  // s goes away with the flush, but the target set is kept in the sparse
+  // set, so the match can go on from the rebuilt target state.
+  lazy_dfa_flush(d);
+
+  return lazy_dfa_add_state(d, d->target->dense, d->target->len);
+}
+
+int lazy_dfa_run(lazy_dfa *d, int *s, const char *str, int str_len) {
+  const unsigned char *byte_classes = d->n->byte_classes;
+  int flushes = d->flushes;
+  int curr = *s;
+
+  for (int i = 0; i < str_len; i++) {
+    unsigned char c = (unsigned char)str[i];
+    int t =
+        d->transitions[(size_t)curr * d->number_of_classes + byte_classes[c]];
+
+    REGEX_STATS_ONLY(d->stats.dfa_cache_hits += t != DFA_UNKNOWN_STATE;)
+
+    if (t == DFA_UNKNOWN_STATE) {
+      t = lazy_dfa_next_state(d, curr, c);
+
+      if (t == DFA_UNKNOWN_STATE)
+        return -1;
+
+      if (d->flushes - flushes > LAZY_DFA_MAX_FLUSHES) {
+        *s = t;
+        return i + 1;
+      }
+    }
+
+    curr = t;
+
+    // the dead state only leads to itself, so the rest of the input can not
+    // change the outcome.
+    if (curr == d->dead)
+      break;
+  }
+
+  *s = curr;
+  return str_len;
+}
+
+int lazy_dfa_match(lazy_dfa *d, const char *str, int str_len) {
+  int s = d->init;
+  int consumed = lazy_dfa_run(d, &s, str, str_len);
+
+  if (consumed == -1)
+    return -1;
+
+  if (consumed < str_len)
+    return LAZY_DFA_GAVE_UP;
+
+  return d->states[s].accepting;
+}
+
+int lazy_dfa_find(lazy_dfa *d, const char *str, int str_len, int *end) {
+  const unsigned char *byte_classes = d->n->byte_classes;
+  int flushes = d->flushes;
+  int s = d->init;
+
+  for (int i = 0; i < str_len; i++) {
+    if (d->states[s].accepting) {
+      *end = i;
+      return 1;
+    }
+
+    unsigned char c = (unsigned char)str[i];
+    int t = d->transitions[(size_t)s * d->number_of_classes + byte_classes[c]];
+
+    REGEX_STATS_ONLY(d->stats.dfa_cache_hits += t != DFA_UNKNOWN_STATE;)
+
+    if (t == DFA_UNKNOWN_STATE) {
+      t = lazy_dfa_next_state(d, s, c);
+
+      if (t == DFA_UNKNOWN_STATE)
+        return -1;
+
+      if (d->flushes - flushes > LAZY_DFA_MAX_FLUSHES)
+        return LAZY_DFA_GAVE_UP;
+    }
+
+    s = t;
+
+    if (s == d->dead)
+      return 0;
+  }
+
+  *end = str_len;
+  return d->states[s].accepting;
+}
+
+// the state tables of a dfa under construction grow on the heap and are
+// copied into one arena block once the number of states is known.
+typedef struct dfa_builder {
+  nfa *n;
+  int number_of_states;
+  int max_states;
+  int *set_offsets;
+  int *set_lens;
+  unsigned int *hashes;
+  int *transitions;
+  char *accepting;
+  int *sets;
+  int sets_len;
+  int sets_max;
+  int *table;
+  int table_mask;
+} dfa_builder;
+
+static void free_dfa_builder(dfa_builder *b) {
+  free(b->set_offsets);
+  free(b->set_lens);
+  free(b->hashes);
+  free(b->transitions);
+  free(b->accepting);
+  free(b->sets);
+  free(b->table);
+}
+
+static int grow_dfa_builder(dfa_builder *b) {
+  int max = b->max_states * 2;
+
+  int *set_offsets = (int *)realloc(b->set_offsets, sizeof(int) * max);
+  if (set_offsets == NULL)
+    return -1;
+  b->set_offsets = set_offsets;
+
+  int *set_lens = (int *)realloc(b->set_lens, sizeof(int) * max);
+  if (set_lens == NULL)
+    return -1;
+  b->set_lens = set_lens;
+
+  unsigned int *hashes =
+      (unsigned int *)realloc(b->hashes, sizeof(unsigned int) * max);
+  if (hashes == NULL)
+    return -1;
+  b->hashes = hashes;
+
+  int *transitions = (int *)realloc(
+      b->transitions, sizeof(int) * b->n->number_of_classes * (size_t)max);
+  if (transitions == NULL)
+    return -1;
+  b->transitions = transitions;
+
+  char *accepting = (char *)realloc(b->accepting, max);
+  if (accepting == NULL)
+    return -1;
+  b->accepting = accepting;
+
+  // the hash table stays at most half full.
+  int table_len = (b->table_mask + 1) * 2;
+  int *table = (int *)malloc(sizeof(int) * table_len);
+  if (table == NULL)
+    return -1;
+
+  for (int i = 0; i < table_len; i++)
+    table[i] = DFA_UNKNOWN_STATE;
+
+  for (int i = 0; i < b->number_of_states; i++) {
+    int slot = b->hashes[i] & (table_len - 1);
+
+    while (table[slot] != DFA_UNKNOWN_STATE)
+      slot = (slot + 1) & (table_len - 1);
+
+    table[slot] = i;
+  }
+
+  free(b->table);
+  b->table = table;
+  b->table_mask = table_len - 1;
+  b->max_states = max;
+
+  return 0;
+}
+
+static int dfa_builder_add_state(dfa_builder *b, const int *set, int set_len) {
+  unsigned int h = hash_set(set, set_len);
+  int slot = h & b->table_mask;
+
+  while (b->table[slot] != DFA_UNKNOWN_STATE) {
+    int id = b->table[slot];
+
+    if (b->hashes[id] == h && b->set_lens[id] == set_len &&
+        memcmp(b->sets + b->set_offsets[id], set, sizeof(int) * set_len) == 0)
+      return id;
+
+    slot = (slot + 1) & b->table_mask;
+  }
+
+  if (b->number_of_states == b->max_states) {
+    if (grow_dfa_builder(b) == -1)
+      return -1;
+
+    slot = h & b->table_mask;
+
+    while (b->table[slot] != DFA_UNKNOWN_STATE)
+      slot = (slot + 1) & b->table_mask;
+  }
+
+  if (b->sets_len + set_len > b->sets_max) {
+    int sets_max = b->sets_max * 2;
+
+    while (sets_max < b->sets_len + set_len)
+      sets_max *= 2;
+
+    int *sets = (int *)realloc(b->sets, sizeof(int) * sets_max);
+    if (sets == NULL)
+      return -1;
+
+    b->sets = sets;
+    b->sets_max = sets_max;
+  }
+
+  int id = b->number_of_states++;
+
+  b->set_offsets[id] = b->sets_len;
+  b->set_lens[id] = set_len;
+  b->hashes[id] = h;
+  b->accepting[id] = 0;
+  b->table[slot] = id;
+
+  for (int i = 0; i < set_len; i++) {
+    if (is_nfa_final(b->n, set[i]))
+      b->accepting[id] = 1;
+  }
+
+  if (set_len > 0)
+    memcpy(b->sets + b->sets_len, set, sizeof(int) * set_len);
+
+  b->sets_len += set_len;
+
+  return id;
+}
+
+static dfa *new_dfa(int number_of_states, int number_of_classes,
+                    const unsigned char *byte_classes) {
+  size_t transitions_size =
+      sizeof(int) * number_of_classes * (size_t)number_of_states;
+  arena *mem = new_arena(sizeof(dfa) + transitions_size + number_of_states +
+                         ARENA_ALIGNMENT * 3);
+
+  if (mem == NULL)
+    return NULL;
+
+  dfa *d = (dfa *)arena_alloc(mem, sizeof(dfa));
+
+  if (d == NULL) {
+    free_arena(mem);
+    return NULL;
+  }
+
+  d->number_of_states = number_of_states;
+  d->number_of_classes = number_of_classes;
+  memcpy(d->byte_classes, byte_classes, sizeof(d->byte_classes));
+  d->transitions = (int *)arena_alloc(mem, transitions_size);
+  d->accepting = (char *)arena_alloc(mem, number_of_states);
+  d->mem = mem;
+
+  if (d->transitions == NULL || d->accepting == NULL) {
+    free_arena(mem);
+    return NULL;
+  }
+
+  return d;
+}
+
+dfa *new_dfa_from_nfa(nfa *n, int max_states, int unanchored, int *err) {
+  dfa_builder b;
+  b.n = n;
+  b.number_of_states = 0;
+  b.max_states = 0;
+  b.set_offsets = NULL;
+  b.set_lens = NULL;
+  b.hashes = NULL;
+  b.transitions = NULL;
+  b.accepting = NULL;
+  b.sets_len = 0;
+  b.sets_max = n->number_of_states + 16;
+  b.sets = (int *)malloc(sizeof(int) * b.sets_max);
+  b.table = NULL;
+
+  // grow_dfa_builder doubles both of these and allocates the first tables.
+  b.max_states = 4;
+  b.table_mask = 7;
+
+  *err = -1;
+
+  sparse_set *target = new_sparse_set(n->number_of_states, NULL);
+  int *init_set = (int *)malloc(sizeof(int) * (n->number_of_states + 1));
+
+  if (b.sets == NULL || target == NULL || init_set == NULL ||
+      grow_dfa_builder(&b) == -1) {
+    if (target != NULL)
+      free_sparse_set(target);
+    free(init_set);
+    free_dfa_builder(&b);
+    return NULL;
+  }
+
+  // class 0 holds the bytes no nfa state reads, every other class stands
+  // for a single byte.
+  int classes_len = n->number_of_classes;
+  unsigned char symbols[NFA_ALPHABET_SIZE];
+
+  for (int c = 0; c < NFA_ALPHABET_SIZE; c++)
+    symbols[n->byte_classes[c]] = c;
+
+  int closures_len;
+  const int *closures = get_epsilon_closures(n, n->init, &closures_len);
+  int init_set_len = closures_len;
+  memcpy(init_set, closures, sizeof(int) * closures_len);
+  qsort(init_set, closures_len, sizeof(int), compare_states);
+
+  int dead = dfa_builder_add_state(&b, NULL, 0);
+  int init = dfa_builder_add_state(&b, init_set, closures_len);
+
+  if (dead == -1 || init == -1) {
+    free(init_set);
+    free_sparse_set(target);
+    free_dfa_builder(&b);
+    return NULL;
+  }
+
+  // states are numbered in the order they are found, so walking the ids
+  // is a breadth first walk of the subset construction. an unanchored dfa
+  // adds the initial set to every target like the lazy one does, so even
+  // class 0 leads back to a live state.
+  for (int s = 0; s < b.number_of_states; s++) {
+    b.transitions[(size_t)s * classes_len] = unanchored ? init : dead;
+
+    for (int k = 1; k < classes_len; k++) {
+      unsigned char c = symbols[k];
+      const int *set = b.sets + b.set_offsets[s];
+
+      sparse_set_clear(target);
+
+      if (unanchored) {
+        for (int i = 0; i < init_set_len; i++)
+          sparse_set_add(target, init_set[i]);
+      }
+
+      for (int i = 0; i < b.set_lens[s]; i++) {
+        nfa_state *from = &n->states[set[i]];
+
+        if (from->symbol == '\0' || (unsigned char)from->symbol != c)
+          continue;
+
+        closures = get_epsilon_closures(n, from->next, &closures_len);
+
+        for (int j = 0; j < closures_len; j++)
+          sparse_set_add(target, closures[j]);
+      }
+
+      qsort(target->dense, target->len, sizeof(int), compare_states);
+
+      int t = dfa_builder_add_state(&b, target->dense, target->len);
+
+      if (t == -1 || b.number_of_states > max_states) {
+        if (t != -1)
+          *err = DFA_TOO_MANY_STATES;
+
+        free(init_set);
+        free_sparse_set(target);
+        free_dfa_builder(&b);
+        return NULL;
+      }
+
+      b.transitions[(size_t)s * classes_len + k] = t;
+    }
+  }
+
+  free(init_set);
+  free_sparse_set(target);
+
+  dfa *d = new_dfa(b.number_of_states, classes_len, n->byte_classes);
+
+  if (d == NULL) {
+    free_dfa_builder(&b);
+    return NULL;
+  }
+
+  d->init = init;
+  d->dead = dead;
+  memcpy(d->transitions, b.transitions,
+         sizeof(int) * classes_len * (size_t)b.number_of_states);
+  memcpy(d->accepting, b.accepting, b.number_of_states);
+
+  free_dfa_builder(&b);
+  *err = 0;
+
+  return d;
+}
+
+dfa *minimize_dfa(dfa *d) {
+  int states_len = d->number_of_states;
+  int classes_len = d->number_of_classes;
+
+  // classes every state sends to the dead state can never split a block.
+  int symbols_len = 0;
+  int symbols[NFA_ALPHABET_SIZE];
+
+  for (int c = 0; c < classes_len; c++) {
+    for (int s = 0; s < states_len; s++) {
+      if (d->transitions[(size_t)s * classes_len + c] != d->dead) {
+        symbols[symbols_len++] = c;
+        break;
+      }
+    }
+  }
+
+  // predecessors of every state on every symbol, laid out like the nfa
+  // closures: preds[pred_offsets[k][q]] up to preds[pred_offsets[k][q + 1]].
+  // the worklist holds each (block, symbol) pair at most once.
+  size_t offsets_len = (size_t)symbols_len * (states_len + 1);
+  size_t pairs_len = (size_t)symbols_len * states_len + 1;
+  arena *tmp = new_arena(sizeof(int) * (offsets_len + pairs_len * 3) +
+                         sizeof(int) * 8 * states_len + pairs_len +
+                         ARENA_ALIGNMENT * 12);
+
+  if (tmp == NULL)
+    return NULL;
+
+  int *pred_offsets = (int *)arena_alloc(tmp, sizeof(int) * offsets_len);
+  int *preds = (int *)arena_alloc(tmp, sizeof(int) * pairs_len);
+  int *elems = (int *)arena_alloc(tmp, sizeof(int) * states_len);
+  int *loc = (int *)arena_alloc(tmp, sizeof(int) * states_len);
+  int *block_of = (int *)arena_alloc(tmp, sizeof(int) * states_len);
+  int *first = (int *)arena_alloc(tmp, sizeof(int) * states_len);
+  int *end = (int *)arena_alloc(tmp, sizeof(int) * states_len);
+  int *marked = (int *)arena_alloc(tmp, sizeof(int) * states_len);
+  int *touched = (int *)arena_alloc(tmp, sizeof(int) * states_len);
+  char *in_work = (char *)arena_alloc(tmp, pairs_len);
+  int *work = (int *)arena_alloc(tmp, sizeof(int) * 2 * pairs_len);
+  int *splitter = (int *)arena_alloc(tmp, sizeof(int) * states_len);
+
+  if (pred_offsets == NULL || preds == NULL || elems == NULL || loc == NULL ||
+      block_of == NULL || first == NULL || end == NULL || marked == NULL ||
+      touched == NULL || in_work == NULL || work == NULL || splitter == NULL) {
+    free_arena(tmp);
+    return NULL;
+  }
+
+  memset(pred_offsets, 0, sizeof(int) * offsets_len);
+  memset(marked, 0, sizeof(int) * states_len);
+  memset(in_work, 0, pairs_len);
+
+  for (int k = 0; k < symbols_len; k++) {
+    int *offsets = pred_offsets + (size_t)k * (states_len + 1);
+
+    for (int s = 0; s < states_len; s++)
+      offsets[d->transitions[(size_t)s * classes_len + symbols[k]] + 1]++;
+
+    for (int q = 0; q < states_len; q++)
+      offsets[q + 1] += offsets[q];
+
+    int base = k * states_len;
+
+    for (int s = 0; s < states_len; s++) {
+      int q = d->transitions[(size_t)s * classes_len + symbols[k]];
+      preds[base + offsets[q]++] = s;
+    }
+
+    // the fill above moved every offset one slot ahead.
+    for (int q = states_len; q > 0; q--)
+      offsets[q] = offsets[q - 1] + base;
+
+    offsets[0] = base;
+  }
+
+  // start from accepting and rejecting states, then split blocks until no
+  // block has states going to different blocks on the same symbol.
+  int blocks_len = 0;
+  int len = 0;
+
+  for (int accepting = 1; accepting >= 0; accepting--) {
+    int start = len;
+
+    for (int s = 0; s < states_len; s++) {
+      if (d->accepting[s] == accepting) {
+        loc[s] = len;
+        elems[len++] = s;
+        block_of[s] = blocks_len;
+      }
+    }
+
+    if (len > start) {
+      first[blocks_len] = start;
+      end[blocks_len] = len;
+      blocks_len++;
+    }
+  }
+
+  int work_len = 0;
+
+  if (blocks_len == 2) {
+    int smaller = end[0] - first[0] <= end[1] - first[1] ? 0 : 1;
+
+    for (int k = 0; k < symbols_len; k++) {
+      work[work_len++] = smaller;
+      work[work_len++] = k;
+      in_work[(size_t)smaller * symbols_len + k] = 1;
+    }
+  }
+
+  while (work_len > 0) {
+    int k = work[--work_len];
+    int a = work[--work_len];
+    in_work[(size_t)a * symbols_len + k] = 0;
+
+    // a can be split while its predecessors are marked, so its states are
+    // copied first.
+    int splitter_len = end[a] - first[a];
+    memcpy(splitter, elems + first[a], sizeof(int) * splitter_len);
+
+    int *offsets = pred_offsets + (size_t)k * (states_len + 1);
+    int touched_len = 0;
+
+    for (int i = 0; i < splitter_len; i++) {
+      int q = splitter[i];
+
+      for (int j = offsets[q]; j < offsets[q + 1]; j++) {
+        int p = preds[j];
+        int b = block_of[p];
+        int pos = first[b] + marked[b];
+
+        if (loc[p] < pos)
+          continue;
+
+        int other = elems[pos];
+        elems[pos] = p;
+        elems[loc[p]] = other;
+        loc[other] = loc[p];
+        loc[p] = pos;
+
+        if (marked[b]++ == 0)
+          touched[touched_len++] = b;
+      }
+    }
+
+    for (int i = 0; i < touched_len; i++) {
+      int b = touched[i];
+      int marked_len = marked[b];
+      marked[b] = 0;
+
+      if (marked_len == end[b] - first[b])
+        continue;
+
+      int nb = blocks_len++;
+      first[nb] = first[b];
+      end[nb] = first[b] + marked_len;
+      first[b] = end[nb];
+
+      for (int j = first[nb]; j < end[nb]; j++)
+        block_of[elems[j]] = nb;
+
+      for (int c = 0; c < symbols_len; c++) {
+        int add = nb;
+
+        if (!in_work[(size_t)b * symbols_len + c] &&
+            end[b] - first[b] < end[nb] - first[nb])
+          add = b;
+
+        in_work[(size_t)add * symbols_len + c] = 1;
+        work[work_len++] = add;
+        work[work_len++] = c;
+      }
+    }
+  }
+
+  dfa *m = new_dfa(blocks_len, classes_len, d->byte_classes);
+
+  if (m == NULL) {
+    free_arena(tmp);
+    return NULL;
+  }
+
+  m->init = block_of[d->init];
+  m->dead = block_of[d->dead];
+
+  for (int b = 0; b < blocks_len; b++) {
+    int rep = elems[first[b]];
+
+    m->accepting[b] = d->accepting[rep];
+
+    for (int c = 0; c < classes_len; c++) {
+      int t = d->transitions[(size_t)rep * classes_len + c];
+      m->transitions[(size_t)b * classes_len + c] = block_of[t];
+    }
+  }
+
+  free_arena(tmp);
+  return m;
+}
+
+void free_dfa(dfa *d) {
+  if (d == NULL)
+    return;
+
+  free_arena(d->mem);
+}
+
+int dfa_run(dfa *d, int s, const char *str, int str_len) {
+  for (int i = 0; i < str_len; i++) {
+    unsigned char c = (unsigned char)str[i];
+    s = d->transitions[(size_t)s * d->number_of_classes + d->byte_classes[c]];
+
+    if (s == d->dead)
+      return s;
+  }
+
+  return s;
+}
+
+int dfa_match(dfa *d, const char *str, int str_len) {
+  return d->accepting[dfa_run(d, d->init, str, str_len)];
+}
@@ -0,0 +1,95 @@
+#ifndef DFA_H_
+#define DFA_H_
+
+#include "arena.h"
+#include "nfa.h"
+#include "stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DFA_UNKNOWN_STATE -1
+
+// returned by lazy_dfa_match when the cache had to be flushed so often that
+// the nfa simulation is the better choice for the input.
+#define LAZY_DFA_GAVE_UP -2
+#define LAZY_DFA_MAX_FLUSHES 16
+
+// a dfa state is the sorted set of nfa states with a symbol transition, plus
+// the final state, that the nfa can be in. its set lives in the sets pool.
+typedef struct lazy_dfa_state {
+  int set_offset;
+  int set_len;
+  int accepting;
+  unsigned int hash;
+} lazy_dfa_state;
+
+// dfa states and their transitions are built while matching and kept in
+// tables sized from memory_limit once. a state has one transition per byte
+// class of the nfa. when a table is full the whole cache is flushed and
+// rebuilt from the state the match is in. an unanchored dfa adds the initial
+// set to every target, so its states tell whether a match ending at the
+// current byte started anywhere before it. stats holds the states,
+// closures and cache hits and misses of the dfa when built with REGEX_STATS.
+typedef struct lazy_dfa {
+  nfa *n;
+  int unanchored;
+  int number_of_classes;
+  int init;
+  int dead;
+  int number_of_states;
+  int max_states;
+  int *transitions;
+  lazy_dfa_state *states;
+  int *sets;
+  int sets_len;
+  int sets_max;
+  int *table;
+  int table_mask;
+  int flushes;
+  int *init_set;
+  int init_set_len;
+  sparse_set *target;
+  regex_stats stats;
+  arena *mem;
+} lazy_dfa;
+
+// a fully determinized and minimized dfa with one row of transitions per
+// state and one column per byte class. dead is the state that can never
+// reach an accepting one.
+typedef struct dfa {
+  int number_of_states;
+  int number_of_classes;
+  unsigned char byte_classes[NFA_ALPHABET_SIZE];
+  int init;
+  int dead;
+  int *transitions;
+  char *accepting;
+  arena *mem;
+} dfa;
+
+#define DFA_TOO_MANY_STATES -3
+
+// lazy_dfa_run and dfa_run move a state over str, so a match can go on
+// where the last piece of input left it. lazy_dfa_run leaves the state in
+// *s and returns how many bytes it took, which is less than str_len when it
+// gave up, or -1 when a state could not be added. lazy_dfa_find returns 1
+// and the offset at which the first accepting state is reached in *end, or 0
+// when no accepting state is reached.
+lazy_dfa *new_lazy_dfa(nfa *n, size_t memory_limit, int unanchored);
+void free_lazy_dfa(lazy_dfa *d);
+void lazy_dfa_flush(lazy_dfa *d);
+
+int lazy_dfa_add_state(lazy_dfa *d, const int *set, int set_len);
+int lazy_dfa_next_state(lazy_dfa *d, int s, unsigned char c);
+int lazy_dfa_run(lazy_dfa *d, int *s, const char *str, int str_len);
+int lazy_dfa_match(lazy_dfa *d, const char *str, int str_len);
+int lazy_dfa_find(lazy_dfa *d, const char *str, int str_len, int *end);
+
+dfa *new_dfa_from_nfa(nfa *n, int max_states, int unanchored, int *err);
+dfa *minimize_dfa(dfa *d);
+void free_dfa(dfa *d);
+int dfa_run(dfa *d, int s, const char *str, int str_len);
+int dfa_match(dfa *d, const char *str, int str_len);
+
+#endif
@@ -0,0 +1,322 @@
+#include "dfa_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t align_file_offset(uint64_t offset) {
+  uint64_t mask = DFA_FILE_ALIGNMENT - 1;
+
+  return (offset + mask) & ~mask;
+}
+
+static int write_file_padding(FILE *out, uint64_t *offset) {
+  static const char zeros[DFA_FILE_ALIGNMENT] = {0};
+  uint64_t aligned = align_file_offset(*offset);
+
+  if (fwrite(zeros, 1, aligned - *offset, out) != aligned - *offset)
+    return -1;
+
+  *offset = aligned;
+  return 0;
+}
+
+static int write_file_data(FILE *out, const void *data, size_t len,
+                           uint64_t *offset) {
+  if (write_file_padding(out, offset) == -1 ||
+      fwrite(data, 1, len, out) != len)
+    return -1;
+
+  *offset += len;
+  return 0;
+}
+
+// every pattern is compiled to a minimized dfa first, since the offsets of
+// the data depend on the sizes of all of them. failed is the index of the
+// pattern that could not be compiled, or -1 when writing failed.
+int write_dfa_file(const char *path, const char **patterns, int count,
+                   const regex_options *options, int *failed) {
+  if (failed != NULL)
+    *failed = -1;
+
+  if (path == NULL || patterns == NULL || count < 0)
+    return -1;
+
+  regex_options full;
+  memset(&full, 0, sizeof(full));
+
+  if (options != NULL)
+    full = *options;
+
+  full.full_dfa = 1;
+
+  regex **compiled = (regex **)calloc(count > 0 ? count : 1, sizeof(regex *));
+  dfa_file_entry *entries = (dfa_file_entry *)calloc(
+      count > 0 ? count : 1, sizeof(dfa_file_entry));
+
+  if (compiled == NULL || entries == NULL) {
+    free(entries);
+    free(compiled);
+    return -1;
+  }
+
+  int val = 0;
+  uint64_t offset = align_file_offset(sizeof(dfa_file_header));
+  uint64_t entries_offset = offset;
+
+  offset += sizeof(dfa_file_entry) * (uint64_t)count;
+
+  for (int i = 0; i < count && val == 0; i++) {
+    compiled[i] = regex_compile_with_options(patterns[i], &full, NULL);
+
+    if (compiled[i] == NULL) {
+      if (failed != NULL)
+        *failed = i;
+
+      val = -1;
+      break;
+    }
+
+    dfa *d = compiled[i]->full;
+    dfa_file_entry *e = &entries[i];
+    size_t transitions_len =
+        sizeof(int) * d->number_of_classes * (size_t)d->number_of_states;
+
+    e->pattern_len = strlen(patterns[i]);
+    e->number_of_states = d->number_of_states;
+    e->number_of_classes = d->number_of_classes;
+    e->init = d->init;
+    e->dead = d->dead;
+    memcpy(e->byte_classes, d->byte_classes, sizeof(e->byte_classes));
+
+    e->pattern_offset = align_file_offset(offset);
+    offset = e->pattern_offset + e->pattern_len + 1;
+    e->transitions_offset = align_file_offset(offset);
+    offset = e->transitions_offset + transitions_len;
+    e->accepting_offset = align_file_offset(offset);
+    offset = e->accepting_offset + d->number_of_states;
+  }
+
+  FILE *out = val == 0 ? fopen(path, "wb") : NULL;
+
+  if (out == NULL)
+    val = -1;
+
+  if (val == 0) {
+    dfa_file_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DFA_FILE_MAGIC, sizeof(h.magic));
+    h.version = DFA_FILE_VERSION;
+    h.byte_order = DFA_FILE_BYTE_ORDER;
+    h.int_size = sizeof(int);
+    h.count = count;
+    h.size = offset;
+    h.entries_offset = entries_offset;
+
+    uint64_t written = 0;
+
+    if (write_file_data(out, &h, sizeof(h), &written) == -1 ||
+        write_file_data(out, entries, sizeof(dfa_file_entry) * count,
+                        &written) == -1)
+      val = -1;
+
+    for (int i = 0; i < count && val == 0; i++) {
+      dfa *d = compiled[i]->full;
+
+      if (write_file_data(out, patterns[i], entries[i].pattern_len + 1,
+                          &written) == -1 ||
+          write_file_data(out, d->transitions,
+                          sizeof(int) * d->number_of_classes *
+                              (size_t)d->number_of_states,
+                          &written) == -1 ||
+          write_file_data(out, d->accepting, d->number_of_states, &written) ==
+              -1)
+        val = -1;
+    }
+  }
+
+  if (out != NULL && fclose(out) != 0)
+    val = -1;
+
+  for (int i = 0; i < count; i++)
+    regex_free(compiled[i]);
+
+  free(entries);
+  free(compiled);
+
+  if (val == -1 && out != NULL)
+    remove(path);
+
+  return val;
+}
+
+static int dfa_file_fits(const dfa_file *f, uint64_t offset, uint64_t len) {
+  return offset <= f->size && len <= f->size - offset;
+}
+
+// every byte class has to pick a column of the transitions, or matching
+// would read past the tables.
+static int dfa_file_classes_valid(const dfa_file_entry *e) {
+  for (int c = 0; c < NFA_ALPHABET_SIZE; c++) {
+    if (e->byte_classes[c] >= e->number_of_classes)
+      return 0;
+  }
+
+  return 1;
+}
+
+// every transition has to lead to a state. this reads the whole table, so
+// it is left to the first dfa_file_get of the entry.
+static int dfa_file_transitions_valid(const dfa_file *f,
+                                      const dfa_file_entry *e) {
+  const int *transitions = (const int *)(f->base + e->transitions_offset);
+  size_t transitions_len =
+      (size_t)e->number_of_states * (size_t)e->number_of_classes;
+
+  for (size_t i = 0; i < transitions_len; i++) {
+    if (transitions[i] < 0 || transitions[i] >= e->number_of_states)
+      return 0;
+  }
+
+  return 1;
+}
+
+dfa_file *open_dfa_file(const char *path) {
+  int fd = open(path, O_RDONLY);
+
+  if (fd == -1)
+    return NULL;
+
+  struct stat st;
+
+  if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(dfa_file_header)) {
+    close(fd);
+    return NULL;
+  }
+
+  void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (base == MAP_FAILED)
+    return NULL;
+
+  dfa_file *f = (dfa_file *)malloc(sizeof(dfa_file));
+
+  if (f == NULL) {
+    munmap(base, st.st_size);
+    return NULL;
+  }
+
+  f->base = (const unsigned char *)base;
+  f->size = st.st_size;
+  f->checked = NULL;
+
+  const dfa_file_header *h = (const dfa_file_header *)f->base;
+  int valid = memcmp(h->magic, DFA_FILE_MAGIC, sizeof(h->magic)) == 0 &&
+              h->version == DFA_FILE_VERSION &&
+              h->byte_order == DFA_FILE_BYTE_ORDER &&
+              h->int_size == sizeof(int) && h->size == f->size &&
+              h->count <= INT32_MAX &&
+              h->entries_offset % DFA_FILE_ALIGNMENT == 0 &&
+              dfa_file_fits(f, h->entries_offset,
+                            sizeof(dfa_file_entry) * (uint64_t)h->count);
+
+  f->count = valid ? h->count : 0;
+  f->entries = (const dfa_file_entry *)(f->base + h->entries_offset);
+
+  for (int i = 0; i < f->count && valid; i++) {
+    const dfa_file_entry *e = &f->entries[i];
+    uint64_t transitions_len = sizeof(int) * (uint64_t)e->number_of_classes *
+                               (uint64_t)e->number_of_states;
+
+    valid = e->number_of_states > 0 && e->number_of_classes > 0 &&
+            e->number_of_classes <= NFA_ALPHABET_SIZE && e->init >= 0 &&
+            e->init < e->number_of_states && e->dead >= 0 &&
+            e->dead < e->number_of_states &&
+            e->transitions_offset % DFA_FILE_ALIGNMENT == 0 &&
+            dfa_file_fits(f, e->pattern_offset, e->pattern_len + 1ull) &&
+            f->base[e->pattern_offset + e->pattern_len] == '\0' &&
+            dfa_file_fits(f, e->transitions_offset, transitions_len) &&
+            dfa_file_fits(f, e->accepting_offset, e->number_of_states) &&
+            dfa_file_classes_valid(e);
+  }
+
+  if (valid) {
+    f->checked = (char *)calloc(f->count > 0 ? f->count : 1, 1);
+    valid = f->checked != NULL;
+  }
+
+  if (!valid) {
+    close_dfa_file(f);
+    return NULL;
+  }
+
+  return f;
+}
+
+void close_dfa_file(dfa_file *f) {
+  if (f == NULL)
+    return;
+
+  munmap((void *)f->base, f->size);
+  free(f->checked);
+  free(f);
+}
+
+const char *dfa_file_pattern(const dfa_file *f, int i) {
+  if (i < 0 || i >= f->count)
+    return NULL;
+
+  return (const char *)(f->base + f->entries[i].pattern_offset);
+}
+
+// d points into the mapping and must not be freed with free_dfa. an entry is
+// checked at most once per thread that races for it, and every check gives
+// the same answer, so checked needs no lock.
+int dfa_file_get(const dfa_file *f, int i, dfa *d) {
+  if (i < 0 || i >= f->count)
+    return -1;
+
+  const dfa_file_entry *e = &f->entries[i];
+  char checked = __atomic_load_n(&f->checked[i], __ATOMIC_RELAXED);
+
+  if (checked == 0) {
+    checked = dfa_file_transitions_valid(f, e) ? 1 : -1;
+    __atomic_store_n(&f->checked[i], checked, __ATOMIC_RELAXED);
+  }
+
+  if (checked == -1)
+    return -1;
+
+  d->number_of_states = e->number_of_states;
+  d->number_of_classes = e->number_of_classes;
+  memcpy(d->byte_classes, e->byte_classes, sizeof(d->byte_classes));
+  d->init = e->init;
+  d->dead = e->dead;
+  d->transitions = (int *)(f->base + e->transitions_offset);
+  d->accepting = (char *)(f->base + e->accepting_offset);
+  d->mem = NULL;
+
+  return 0;
+}
+
+int dfa_file_match(const dfa_file *f, int i, const char *str, int str_len) {
+  if (i < 0 || i >= f->count || (str == NULL && str_len > 0))
+    return -1;
+
+  const dfa_file_entry *e = &f->entries[i];
+  const int *transitions = (const int *)(f->base + e->transitions_offset);
+  int s = e->init;
+
+  // the byte classes were checked when the file was opened, so only the
+  // state each transition leads to is left to check.
+  for (int k = 0; k < str_len && s != e->dead; k++) {
+    unsigned char c = (unsigned char)str[k];
+    s = transitions[(size_t)s * e->number_of_classes + e->byte_classes[c]];
+
+    if ((unsigned int)s >= (unsigned int)e->number_of_states)
+      return -1;
+  }
+
+  return f->base[e->accepting_offset + s] != 0;
+}
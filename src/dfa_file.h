@@ -0,0 +1,70 @@
+#ifndef DFA_FILE_H_
+#define DFA_FILE_H_
+
+#include "dfa.h"
+#include "regex.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DFA_FILE_MAGIC "REDFA\0\0\0"
+#define DFA_FILE_VERSION 1
+#define DFA_FILE_BYTE_ORDER 0x01020304u
+#define DFA_FILE_ALIGNMENT 16
+
+// a dfa file is a header, one entry per pattern, and then the pattern text,
+// transitions and accepting flags of every dfa, each array aligned to
+// DFA_FILE_ALIGNMENT. every offset counts from the start of the file, so the
+// file can be mapped anywhere and read in place. byte_order is written as
+// DFA_FILE_BYTE_ORDER and int_size as sizeof(int), so a file from a machine
+// with another layout is refused instead of misread.
+typedef struct dfa_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t int_size;
+  uint32_t count;
+  uint64_t size;
+  uint64_t entries_offset;
+} dfa_file_header;
+
+// a minimized dfa laid out like the dfa struct. the pattern text is stored
+// with its terminating zero.
+typedef struct dfa_file_entry {
+  uint64_t pattern_offset;
+  uint64_t transitions_offset;
+  uint64_t accepting_offset;
+  uint32_t pattern_len;
+  int32_t number_of_states;
+  int32_t number_of_classes;
+  int32_t init;
+  int32_t dead;
+  uint32_t reserved;
+  unsigned char byte_classes[NFA_ALPHABET_SIZE];
+} dfa_file_entry;
+
+// a dfa file mapped read only. open_dfa_file checks that the header and
+// every entry fit the file and that every byte class picks a column of its
+// table, so a corrupted file is refused instead of read out of bounds. the
+// transitions are only read when they are used: dfa_file_match checks every
+// state it steps to, and dfa_file_get checks the whole table of an entry the
+// first time it is asked for it and remembers the answer in checked.
+typedef struct dfa_file {
+  const unsigned char *base;
+  size_t size;
+  int count;
+  const dfa_file_entry *entries;
+  char *checked;
+} dfa_file;
+
+int write_dfa_file(const char *path, const char **patterns, int count,
+                   const regex_options *options, int *failed);
+dfa_file *open_dfa_file(const char *path);
+void close_dfa_file(dfa_file *f);
+
+const char *dfa_file_pattern(const dfa_file *f, int i);
+int dfa_file_get(const dfa_file *f, int i, dfa *d);
+int dfa_file_match(const dfa_file *f, int i, const char *str, int str_len);
+
+#endif
@@ -0,0 +1,115 @@
+#include "codegen.h"
+
+// turns a rules file into c source with one direct coded matcher per rule.
+// every line holds the function name and then the pattern, separated by
+// spaces, and a line with only a name stands for the empty pattern. empty
+// lines are skipped.
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    printf("Usage: %s RULES OUTPUT\n", argv[0]);
+    return -1;
+  }
+
+  FILE *in = fopen(argv[1], "r");
+
+  if (in == NULL) {
+    printf("Could not open '%s'\n", argv[1]);
+    return -1;
+  }
+
+  int count = 0;
+  int max = 64;
+  char **names = (char **)malloc(sizeof(char *) * max);
+  char **patterns = (char **)malloc(sizeof(char *) * max);
+  char *line = NULL;
+  size_t line_max = 0;
+  ssize_t len;
+  int val = names != NULL && patterns != NULL ? 0 : -1;
+
+  while (val == 0 && (len = getline(&line, &line_max, in)) != -1) {
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+      line[--len] = '\0';
+
+    char *name = line;
+
+    while (*name == ' ' || *name == '\t')
+      name++;
+
+    if (*name == '\0')
+      continue;
+
+    char *pattern = name;
+
+    while (*pattern != '\0' && *pattern != ' ' && *pattern != '\t')
+      pattern++;
+
+    if (*pattern != '\0')
+      *pattern++ = '\0';
+
+    while (*pattern == ' ' || *pattern == '\t')
+      pattern++;
+
+    if (count == max) {
+      max *= 2;
+      char **grown_names = (char **)realloc(names, sizeof(char *) * max);
+
+      if (grown_names != NULL)
+        names = grown_names;
+
+      char **grown_patterns =
+          (char **)realloc(patterns, sizeof(char *) * max);
+
+      if (grown_patterns != NULL)
+        patterns = grown_patterns;
+
+      if (grown_names == NULL || grown_patterns == NULL) {
+        val = -1;
+        break;
+      }
+    }
+
+    names[count] = strdup(name);
+    patterns[count] = strdup(pattern);
+    count++;
+  }
+
+  free(line);
+  fclose(in);
+
+  FILE *out = val == 0 ? fopen(argv[2], "w") : NULL;
+  int failed = -1;
+
+  if (val == -1) {
+    printf("Ran out of memory reading '%s'\n", argv[1]);
+  } else if (out == NULL) {
+    printf("Could not open '%s'\n", argv[2]);
+    val = -1;
+  } else {
+    val = write_regex_matchers(out, (const char **)names,
+                               (const char **)patterns, count, NULL, &failed);
+
+    if (fclose(out) != 0)
+      val = -1;
+
+    if (val == -1 && failed != -1)
+      printf("Could not generate rule %i '%s %s'\n", failed + 1,
+             names[failed], patterns[failed]);
+    else if (val == -1)
+      printf("Could not write '%s'\n", argv[2]);
+    else
+      printf("Wrote %i matchers to '%s'\n", count, argv[2]);
+
+    if (val == -1)
+      remove(argv[2]);
+  }
+
+  for (int i = 0; i < count; i++) {
+    free(names[i]);
+    free(patterns[i]);
+  }
+
+  free(names);
+  free(patterns);
+
+  return val;
+}
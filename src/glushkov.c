@@ -0,0 +1,259 @@
+#include "glushkov.h"
+#include "nfa.h"
+
+// what the walk over the postfix knows about a fragment of the regex.
+typedef struct glushkov_fragment {
+  int nullable;
+  uint64_t first[GLUSHKOV_MAX_WORDS];
+  uint64_t last[GLUSHKOV_MAX_WORDS];
+} glushkov_fragment;
+
+static void union_bits(uint64_t *dst, const uint64_t *src, int words) {
+  for (int i = 0; i < words; i++)
+    dst[i] |= src[i];
+}
+
+// every state in from is followed by every state in to.
+static void add_follows(uint64_t *follow, const uint64_t *from,
+                        const uint64_t *to, int words) {
+  for (int i = 0; i < words; i++) {
+    uint64_t bits = from[i];
+
+    while (bits != 0) {
+      int p = i * 64 + __builtin_ctzll(bits);
+      bits &= bits - 1;
+      union_bits(follow + (size_t)p * words, to, words);
+    }
+  }
+}
+
+int count_glushkov_positions(const char *regex, int len) {
+  int positions = 1;
+
+  for (int i = 0; i < len; i++) {
+    if (is_nfa_symbol(regex[i]))
+      positions++;
+  }
+
+  return positions;
+}
+
+glushkov *new_glushkov_from_regex(const char *regex, int len, arena *mem) {
+  int positions = count_glushkov_positions(regex, len);
+
+  if (positions > GLUSHKOV_MAX_POSITIONS)
+    return NULL;
+
+  int words = (positions + 63) / 64;
+  int chunks = (positions + 7) / 8;
+
+  glushkov *g = (glushkov *)arena_alloc(mem, sizeof(glushkov));
+
+  if (g == NULL)
+    return NULL;
+
+  g->number_of_positions = positions;
+  g->words = words;
+  g->chunks = chunks;
+  g->mem = mem;
+  g->follows = (uint64_t *)arena_alloc(mem, sizeof(uint64_t) * chunks * 256 *
+                                                words);
+  g->symbols = (uint64_t *)arena_alloc(mem, sizeof(uint64_t) *
+                                                NFA_ALPHABET_SIZE * words);
+
+  uint64_t *follow =
+      (uint64_t *)arena_alloc(mem, sizeof(uint64_t) * positions * words);
+  glushkov_fragment *stack = (glushkov_fragment *)arena_alloc(
+      mem, sizeof(glushkov_fragment) * (len + 1));
+
+  if (g->follows == NULL || g->symbols == NULL || follow == NULL ||
+      stack == NULL) {
+    arena_release(mem, stack);
+    arena_release(mem, follow);
+    free_glushkov(g);
+    return NULL;
+  }
+
+  memset(g->symbols, 0, sizeof(uint64_t) * NFA_ALPHABET_SIZE * words);
+  memset(follow, 0, sizeof(uint64_t) * positions * words);
+
+  int top = -1;
+  int p = 1;
+
+  for (int i = 0; i < len; i++) {
+    char c = regex[i];
+
+    if (is_nfa_symbol(c)) {
+      glushkov_fragment *f = &stack[++top];
+
+      memset(f, 0, sizeof(glushkov_fragment));
+      f->first[p / 64] = (uint64_t)1 << (p % 64);
+      f->last[p / 64] = (uint64_t)1 << (p % 64);
+      g->symbols[(size_t)(unsigned char)c * words + p / 64] |=
+          (uint64_t)1 << (p % 64);
+      p++;
+    } else if (c == '*' && top >= 0) {
+      glushkov_fragment *f = &stack[top];
+
+      add_follows(follow, f->last, f->first, words);
+      f->nullable = 1;
+    } else if (c == '.' && top >= 1) {
+      glushkov_fragment *a = &stack[top - 1];
+      glushkov_fragment *b = &stack[top];
+
+      add_follows(follow, a->last, b->first, words);
+
+      if (a->nullable)
+        union_bits(a->first, b->first, words);
+
+      if (b->nullable)
+        union_bits(b->last, a->last, words);
+
+      memcpy(a->last, b->last, sizeof(a->last));
+      a->nullable = a->nullable && b->nullable;
+      top--;
+    } else if (c == '|' && top >= 1) {
+      glushkov_fragment *a = &stack[top - 1];
+      glushkov_fragment *b = &stack[top];
+
+      union_bits(a->first, b->first, words);
+      union_bits(a->last, b->last, words);
+      a->nullable = a->nullable || b->nullable;
+      top--;
+    } else {
+      arena_release(mem, stack);
+      arena_release(mem, follow);
+      free_glushkov(g);
+      return NULL;
+    }
+  }
+
+  if (top > 0) {
+    arena_release(mem, stack);
+    arena_release(mem, follow);
+    free_glushkov(g);
+    return NULL;
+  }
+
+  // the start is followed by the first states of the regex, and accepts
+  // when the regex matches the empty string. an empty regex has no states
+  // but the start.
+  glushkov_fragment whole;
+  memset(&whole, 0, sizeof(whole));
+  whole.nullable = 1;
+
+  if (top == 0)
+    whole = stack[0];
+
+  memcpy(follow, whole.first, sizeof(uint64_t) * words);
+  memcpy(g->accepting, whole.last, sizeof(g->accepting));
+
+  if (whole.nullable)
+    g->accepting[0] |= 1;
+
+  // the union for a set of eight states is the union for the set without
+  // its lowest state plus the follow set of that state.
+  for (int k = 0; k < chunks; k++) {
+    uint64_t *table = g->follows + (size_t)k * 256 * words;
+
+    memset(table, 0, sizeof(uint64_t) * words);
+
+    for (int v = 1; v < 256; v++) {
+      int s = k * 8 + __builtin_ctz(v);
+      uint64_t *row = table + (size_t)v * words;
+
+      memcpy(row, table + (size_t)(v & (v - 1)) * words,
+             sizeof(uint64_t) * words);
+
+      if (s < positions)
+        union_bits(row, follow + (size_t)s * words, words);
+    }
+  }
+
+  arena_release(mem, stack);
+  arena_release(mem, follow);
+
+  return g;
+}
+
+void free_glushkov(glushkov *g) {
+  arena_release(g->mem, g->symbols);
+  arena_release(g->mem, g->follows);
+  arena_release(g->mem, g);
+}
+
+void glushkov_start(const glushkov *g, uint64_t *state) {
+  memset(state, 0, sizeof(uint64_t) * g->words);
+  state[0] = 1;
+}
+
+int glushkov_run(const glushkov *g, uint64_t *state, const char *str,
+                 int str_len) {
+  int words = g->words;
+
+  // most patterns fit in one word, where a step is a handful of shifts,
+  // lookups and ors.
+  if (words == 1) {
+    uint64_t d = state[0];
+
+    for (int i = 0; i < str_len && d != 0; i++) {
+      uint64_t next = 0;
+      uint64_t bits = d;
+
+      for (int k = 0; bits != 0; k++, bits >>= 8)
+        next |= g->follows[k * 256 + (bits & 0xff)];
+
+      d = next & g->symbols[(unsigned char)str[i]];
+    }
+
+    state[0] = d;
+    return d != 0;
+  }
+
+  uint64_t next[GLUSHKOV_MAX_WORDS];
+  int alive = 1;
+
+  for (int i = 0; i < str_len && alive; i++) {
+    memset(next, 0, sizeof(next));
+
+    for (int k = 0; k < g->chunks; k++) {
+      unsigned int v = (state[k / 8] >> (k % 8 * 8)) & 0xff;
+
+      if (v != 0)
+        union_bits(next, g->follows + ((size_t)k * 256 + v) * words, words);
+    }
+
+    const uint64_t *symbols =
+        g->symbols + (size_t)(unsigned char)str[i] * words;
+    alive = 0;
+
+    for (int w = 0; w < words; w++) {
+      state[w] = next[w] & symbols[w];
+
+      if (state[w] != 0)
+        alive = 1;
+    }
+  }
+
+  return alive;
+}
+
+int glushkov_accepts(const glushkov *g, const uint64_t *state) {
+  for (int w = 0; w < g->words; w++) {
+    if (state[w] & g->accepting[w])
+      return 1;
+  }
+
+  return 0;
+}
+
+int glushkov_match(const glushkov *g, const char *str, int str_len) {
+  uint64_t state[GLUSHKOV_MAX_WORDS];
+
+  glushkov_start(g, state);
+
+  if (!glushkov_run(g, state, str, str_len))
+    return 0;
+
+  return glushkov_accepts(g, state);
+}
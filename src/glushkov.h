@@ -0,0 +1,49 @@
+#ifndef GLUSHKOV_H_
+#define GLUSHKOV_H_
+
+#include "arena.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GLUSHKOV_MAX_WORDS 4
+#define GLUSHKOV_MAX_POSITIONS (GLUSHKOV_MAX_WORDS * 64)
+#define GLUSHKOV_DEFAULT_POSITIONS 64
+
+// the position automaton of a regex has one state per symbol of the regex,
+// plus state 0 for the start, and a state is entered only by reading its
+// symbol. a set of states is a bitset of words 64 bit words, so a step is
+// the union of the follow sets of the current states, masked with the states
+// that read the byte. follows holds that union for every set of eight
+// consecutive states: follows[(k * 256 + v) * words] is the union for the
+// states 8k + b with bit b set in v, so a step takes one lookup per eight
+// states. symbols[c * words] are the states that read c.
+//
+// this is a table driven subset simulation of the position automaton, not
+// shift-and: the follow sets are looked up rather than shifted in. with one
+// word a step is a few lookups, with more it is one per eight states, which
+// the lazy dfa beats once its states are cached. so regex_compile only picks
+// the engine for patterns of at most GLUSHKOV_DEFAULT_POSITIONS positions,
+// and larger automata are only built when asked for directly.
+typedef struct glushkov {
+  int number_of_positions;
+  int words;
+  int chunks;
+  uint64_t *follows;
+  uint64_t *symbols;
+  uint64_t accepting[GLUSHKOV_MAX_WORDS];
+  arena *mem;
+} glushkov;
+
+int count_glushkov_positions(const char *regex, int len);
+glushkov *new_glushkov_from_regex(const char *regex, int len, arena *mem);
+void free_glushkov(glushkov *g);
+
+void glushkov_start(const glushkov *g, uint64_t *state);
+int glushkov_run(const glushkov *g, uint64_t *state, const char *str,
+                 int str_len);
+int glushkov_accepts(const glushkov *g, const uint64_t *state);
+int glushkov_match(const glushkov *g, const char *str, int str_len);
+
+#endif
@@ -0,0 +1,346 @@
+#include "grep.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GREP_X86 1
+#endif
+
+int grep_best_engine() {
+#ifdef GREP_X86
+  if (__builtin_cpu_supports("avx2"))
+    return GREP_AVX2;
+
+  if (__builtin_cpu_supports("sse2"))
+    return GREP_SSE2;
+#endif
+
+  return GREP_SCALAR;
+}
+
+static const char *find_newline_scalar(const char *p, const char *end) {
+  for (; p < end; p++) {
+    if (*p == '\n')
+      return p;
+  }
+
+  return NULL;
+}
+
+#ifdef GREP_X86
+__attribute__((target("sse2"))) static const char *
+find_newline_sse2(const char *p, const char *end) {
+  __m128i newline = _mm_set1_epi8('\n');
+
+  for (; end - p >= 16; p += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    unsigned int found = _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+
+    if (found != 0)
+      return p + __builtin_ctz(found);
+  }
+
+  return find_newline_scalar(p, end);
+}
+
+__attribute__((target("avx2"))) static const char *
+find_newline_avx2(const char *p, const char *end) {
+  __m256i newline = _mm256_set1_epi8('\n');
+
+  for (; end - p >= 32; p += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    unsigned int found = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+
+    if (found != 0)
+      return p + __builtin_ctz(found);
+  }
+
+  return find_newline_scalar(p, end);
+}
+#endif
+
+// the first newline in [p, end), or NULL when there is none.
+const char *grep_find_newline(const char *p, const char *end, int engine) {
+#ifdef GREP_X86
+  if (engine == GREP_AVX2)
+    return find_newline_avx2(p, end);
+
+  if (engine == GREP_SSE2)
+    return find_newline_sse2(p, end);
+#endif
+
+  (void)engine;
+  return find_newline_scalar(p, end);
+}
+
+static int add_chunk_line(grep_chunk *c, const char *str, int len) {
+  if (c->lines_len == c->lines_max) {
+    int max = c->lines_max == 0 ? 64 : c->lines_max * 2;
+    regex_input *lines =
+        (regex_input *)realloc(c->lines, sizeof(regex_input) * max);
+
+    if (lines == NULL)
+      return -1;
+
+    c->lines = lines;
+    c->lines_max = max;
+  }
+
+  c->lines[c->lines_len].str = str;
+  c->lines[c->lines_len].len = len;
+  c->lines_len++;
+
+  return 0;
+}
+
+// a line is everything up to a newline or the end of the chunk, without the
+// newline, and it matches when the pattern is found anywhere in it.
+static int search_chunk(grep_worker *w, grep_chunk *c) {
+  const char *p = w->buf + c->from;
+  const char *end = w->buf + c->to;
+
+  c->matches = 0;
+  c->lines_len = 0;
+
+  while (p < end) {
+    const char *newline = grep_find_newline(p, end, w->engine);
+    const char *line_end = newline != NULL ? newline : end;
+
+    if (line_end - p > INT_MAX)
+      return -1;
+
+    int start;
+    int match_end;
+    int found =
+        regex_search_with(w->context, p, line_end - p, &start, &match_end);
+
+    if (found == -1)
+      return -1;
+
+    if (found == 1) {
+      c->matches++;
+
+      if (!w->count_only && add_chunk_line(c, p, line_end - p) == -1)
+        return -1;
+    }
+
+    p = line_end + 1;
+  }
+
+  return 0;
+}
+
+static void *run_grep_worker(void *arg) {
+  grep_worker *w = (grep_worker *)arg;
+
+  for (;;) {
+    int i = __atomic_fetch_add(w->next_chunk, 1, __ATOMIC_RELAXED);
+
+    if (i >= w->count)
+      break;
+
+    if (search_chunk(w, &w->chunks[i]) == -1)
+      w->failed = 1;
+  }
+
+  return NULL;
+}
+
+// the chunks are searched a round at a time, and each round is written in
+// the order of the buffer before the next one starts, so the output keeps
+// the order of the lines without holding all of them.
+static int search_rounds(grep_worker *workers, int threads, grep_chunk *chunks,
+                         int round, const char *buf, size_t len,
+                         const char *name, const grep_options *options,
+                         FILE *out) {
+  int engine = workers[0].engine;
+  int matches = 0;
+  size_t pos = 0;
+
+  while (pos < len) {
+    int count = 0;
+
+    for (; count < round && pos < len; count++) {
+      size_t to = len - pos > GREP_CHUNK_SIZE ? pos + GREP_CHUNK_SIZE : len;
+
+      if (to < len) {
+        const char *newline =
+            grep_find_newline(buf + to - 1, buf + len, engine);
+        to = newline != NULL ? (size_t)(newline - buf) + 1 : len;
+      }
+
+      chunks[count].from = pos;
+      chunks[count].to = to;
+      pos = to;
+    }
+
+    int next_chunk = 0;
+    int started = 1;
+
+    for (int i = 0; i < threads; i++) {
+      workers[i].chunks = chunks;
+      workers[i].count = count;
+      workers[i].next_chunk = &next_chunk;
+    }
+
+    // a worker that can not be started leaves its chunks to the others.
+    for (; started < threads; started++) {
+      if (pthread_create(&workers[started].thread, NULL, run_grep_worker,
+                         &workers[started]) != 0)
+        break;
+    }
+
+    run_grep_worker(&workers[0]);
+
+    int failed = workers[0].failed;
+
+    for (int i = 1; i < started; i++) {
+      pthread_join(workers[i].thread, NULL);
+      failed |= workers[i].failed;
+    }
+
+    if (failed)
+      return -1;
+
+    for (int i = 0; i < count; i++) {
+      grep_chunk *c = &chunks[i];
+      matches += c->matches;
+
+      for (int k = 0; k < c->lines_len; k++) {
+        if (options->with_names)
+          fprintf(out, "%s:", name);
+
+        fwrite(c->lines[k].str, 1, c->lines[k].len, out);
+        fputc('\n', out);
+      }
+    }
+  }
+
+  return matches;
+}
+
+int grep_buffer(const regex *r, const char *buf, size_t len, const char *name,
+                const grep_options *options, FILE *out) {
+  if (r == NULL || (buf == NULL && len > 0) || out == NULL)
+    return -1;
+
+  grep_options defaults;
+  memset(&defaults, 0, sizeof(defaults));
+
+  if (options == NULL)
+    options = &defaults;
+
+  if (name == NULL)
+    name = "";
+
+  int threads = options->threads;
+
+  if (threads <= 0)
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  // a worker without a chunk of its own would only cost its setup.
+  size_t chunks_len = len / GREP_CHUNK_SIZE + 1;
+
+  if ((size_t)threads > chunks_len)
+    threads = chunks_len;
+
+  if (threads > GREP_MAX_THREADS)
+    threads = GREP_MAX_THREADS;
+
+  if (threads < 1)
+    threads = 1;
+
+  grep_worker workers[GREP_MAX_THREADS];
+  int engine = grep_best_engine();
+  int ready = 0;
+
+  for (int i = 0; i < threads; i++) {
+    grep_worker *w = &workers[i];
+
+    w->buf = buf;
+    w->engine = engine;
+    w->count_only = options->count;
+    w->failed = 0;
+    w->context = NULL;
+  }
+
+  // a worker that can not be set up is left out.
+  for (; ready < threads; ready++) {
+    workers[ready].context = regex_borrow_context(r);
+
+    if (workers[ready].context == NULL)
+      break;
+  }
+
+  if (ready == 0)
+    return -1;
+
+  int round = ready * GREP_CHUNKS_PER_ROUND;
+  grep_chunk *chunks = (grep_chunk *)calloc(round, sizeof(grep_chunk));
+  int matches = -1;
+
+  if (chunks != NULL) {
+    matches = search_rounds(workers, ready, chunks, round, buf, len, name,
+                            options, out);
+
+    for (int i = 0; i < round; i++)
+      free(chunks[i].lines);
+
+    free(chunks);
+  }
+
+  for (int i = 0; i < ready; i++)
+    regex_return_context(r, workers[i].context);
+
+  if (matches != -1 && options->count) {
+    if (options->with_names)
+      fprintf(out, "%s:", name);
+
+    fprintf(out, "%i\n", matches);
+  }
+
+  return matches;
+}
+
+// the file is mapped instead of read, so its lines are searched in place.
+int grep_file(const regex *r, const char *path, const grep_options *options,
+              FILE *out) {
+  int fd = open(path, O_RDONLY);
+
+  if (fd == -1)
+    return -1;
+
+  struct stat st;
+
+  if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return -1;
+  }
+
+  size_t len = st.st_size;
+  char *buf = NULL;
+
+  if (len > 0) {
+    buf = (char *)mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (buf == MAP_FAILED) {
+      close(fd);
+      return -1;
+    }
+
+    madvise(buf, len, MADV_SEQUENTIAL);
+  }
+
+  close(fd);
+
+  int matches = grep_buffer(r, buf, len, path, options, out);
+
+  if (buf != NULL)
+    munmap(buf, len);
+
+  return matches;
+}
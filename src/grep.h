@@ -0,0 +1,65 @@
+#ifndef GREP_H_
+#define GREP_H_
+
+#include "arena.h"
+#include "batch.h"
+#include "dfa.h"
+#include "regex.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// a buffer is split into chunks of about GREP_CHUNK_SIZE bytes that end at
+// a newline, and the workers take them GREP_CHUNKS_PER_ROUND at a time per
+// worker, so at most that many chunks of matching lines wait to be written.
+#define GREP_CHUNK_SIZE (1 << 20)
+#define GREP_CHUNKS_PER_ROUND 4
+#define GREP_MAX_THREADS 256
+
+#define GREP_SCALAR 0
+#define GREP_SSE2 1
+#define GREP_AVX2 2
+
+// zeroed fields pick the defaults. with count set only the number of
+// matching lines is written, and with_names puts the name of the buffer and
+// a colon before every line or count. threads of zero uses every cpu.
+typedef struct grep_options {
+  int count;
+  int with_names;
+  int threads;
+} grep_options;
+
+// the lines of a chunk that matched, as pointers into the buffer.
+typedef struct grep_chunk {
+  size_t from;
+  size_t to;
+  int matches;
+  int lines_len;
+  int lines_max;
+  regex_input *lines;
+} grep_chunk;
+
+// the calling thread is worker 0, and every worker borrows a match context
+// from the regex's pool, like the batch workers.
+typedef struct grep_worker {
+  const char *buf;
+  grep_chunk *chunks;
+  int count;
+  int *next_chunk;
+  int engine;
+  int count_only;
+  int failed;
+  regex_match_context *context;
+  pthread_t thread;
+} grep_worker;
+
+int grep_best_engine();
+const char *grep_find_newline(const char *p, const char *end, int engine);
+
+int grep_buffer(const regex *r, const char *buf, size_t len, const char *name,
+                const grep_options *options, FILE *out);
+int grep_file(const regex *r, const char *path, const grep_options *options,
+              FILE *out);
+
+#endif
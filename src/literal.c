@@ -0,0 +1,276 @@
+#include "literal.h"
+#include "nfa.h"
+
+static void set_literal(char *dst, int *dst_len, const char *src, int len) {
+  if (len > LITERAL_MAX_LEN)
+    len = LITERAL_MAX_LEN;
+
+  memmove(dst, src, len);
+  *dst_len = len;
+}
+
+// a + b cut to the first LITERAL_MAX_LEN bytes, or to the last ones when
+// keep_end is set.
+static void join_literals(char *dst, int *dst_len, const char *a, int a_len,
+                          const char *b, int b_len, int keep_end) {
+  char joined[LITERAL_MAX_LEN * 2];
+
+  memcpy(joined, a, a_len);
+  memcpy(joined + a_len, b, b_len);
+
+  int len = a_len + b_len;
+
+  if (keep_end && len > LITERAL_MAX_LEN)
+    set_literal(dst, dst_len, joined + len - LITERAL_MAX_LEN, LITERAL_MAX_LEN);
+  else
+    set_literal(dst, dst_len, joined, len);
+}
+
+static void keep_longer_required(regex_literals *l, const char *literal,
+                                 int len) {
+  if (len > l->required_len)
+    set_literal(l->required, &l->required_len, literal, len);
+}
+
+static int shortest_alternate(const regex_literals *l) {
+  int len = l->alternates_len > 0 ? LITERAL_MAX_LEN : 0;
+
+  for (int i = 0; i < l->alternates_len; i++) {
+    if (l->alternate_lens[i] < len)
+      len = l->alternate_lens[i];
+  }
+
+  return len;
+}
+
+// the alternates are only replaced by others whose shortest literal is
+// longer, as it is the one that makes a teddy find false candidates.
+static void keep_better_alternates(regex_literals *l,
+                                   const regex_literals *from) {
+  if (shortest_alternate(from) <= shortest_alternate(l))
+    return;
+
+  l->alternates_len = from->alternates_len;
+
+  for (int i = 0; i < from->alternates_len; i++)
+    set_literal(l->alternates[i], &l->alternate_lens[i], from->alternates[i],
+                from->alternate_lens[i]);
+}
+
+static void alternates_from_required(regex_literals *l) {
+  l->alternates_len = 0;
+
+  if (l->required_len > 0) {
+    set_literal(l->alternates[0], &l->alternate_lens[0], l->required,
+                l->required_len);
+    l->alternates_len = 1;
+  }
+}
+
+static void concat_literals(regex_literals *out, const regex_literals *a,
+                            const regex_literals *b) {
+  regex_literals l;
+
+  l.exact = a->exact && b->exact &&
+            a->prefix_len + b->prefix_len <= LITERAL_MAX_LEN;
+
+  if (a->exact)
+    join_literals(l.prefix, &l.prefix_len, a->prefix, a->prefix_len,
+                  b->prefix, b->prefix_len, 0);
+  else
+    set_literal(l.prefix, &l.prefix_len, a->prefix, a->prefix_len);
+
+  if (b->exact)
+    join_literals(l.suffix, &l.suffix_len, a->suffix, a->suffix_len,
+                  b->suffix, b->suffix_len, 1);
+  else
+    set_literal(l.suffix, &l.suffix_len, b->suffix, b->suffix_len);
+
+  // the end of a and the start of b always meet somewhere in the middle.
+  char middle[LITERAL_MAX_LEN];
+  int middle_len;
+  join_literals(middle, &middle_len, a->suffix, a->suffix_len, b->prefix,
+                b->prefix_len, 0);
+
+  l.required_len = 0;
+  keep_longer_required(&l, a->required, a->required_len);
+  keep_longer_required(&l, b->required, b->required_len);
+  keep_longer_required(&l, middle, middle_len);
+  keep_longer_required(&l, l.prefix, l.prefix_len);
+  keep_longer_required(&l, l.suffix, l.suffix_len);
+
+  alternates_from_required(&l);
+  keep_better_alternates(&l, a);
+  keep_better_alternates(&l, b);
+
+  *out = l;
+}
+
+static void alternate_literals(regex_literals *out, const regex_literals *a,
+                               const regex_literals *b) {
+  regex_literals l;
+
+  int prefix_len = 0;
+  while (prefix_len < a->prefix_len && prefix_len < b->prefix_len &&
+         a->prefix[prefix_len] == b->prefix[prefix_len])
+    prefix_len++;
+
+  int suffix_len = 0;
+  while (suffix_len < a->suffix_len && suffix_len < b->suffix_len &&
+         a->suffix[a->suffix_len - suffix_len - 1] ==
+             b->suffix[b->suffix_len - suffix_len - 1])
+    suffix_len++;
+
+  l.exact = a->exact && b->exact && a->prefix_len == b->prefix_len &&
+            prefix_len == a->prefix_len;
+
+  set_literal(l.prefix, &l.prefix_len, a->prefix, prefix_len);
+  set_literal(l.suffix, &l.suffix_len, a->suffix + a->suffix_len - suffix_len,
+              suffix_len);
+
+  l.required_len = 0;
+
+  if (a->required_len == b->required_len &&
+      memcmp(a->required, b->required, a->required_len) == 0)
+    keep_longer_required(&l, a->required, a->required_len);
+
+  keep_longer_required(&l, l.prefix, l.prefix_len);
+  keep_longer_required(&l, l.suffix, l.suffix_len);
+
+  // a match of either side contains one of that side's alternates.
+  alternates_from_required(&l);
+
+  if (a->alternates_len > 0 && b->alternates_len > 0 &&
+      a->alternates_len + b->alternates_len <= LITERAL_MAX_ALTERNATES) {
+    regex_literals both;
+    both.alternates_len = a->alternates_len + b->alternates_len;
+
+    for (int i = 0; i < a->alternates_len; i++)
+      set_literal(both.alternates[i], &both.alternate_lens[i],
+                  a->alternates[i], a->alternate_lens[i]);
+
+    for (int i = 0; i < b->alternates_len; i++)
+      set_literal(both.alternates[a->alternates_len + i],
+                  &both.alternate_lens[a->alternates_len + i],
+                  b->alternates[i], b->alternate_lens[i]);
+
+    keep_better_alternates(&l, &both);
+  }
+
+  *out = l;
+}
+
+static void empty_literals(regex_literals *l, int exact) {
+  l->exact = exact;
+  l->prefix_len = 0;
+  l->suffix_len = 0;
+  l->required_len = 0;
+  l->alternates_len = 0;
+}
+
+int find_regex_literals(const char *postfix, int len, regex_literals *out,
+                        arena *mem) {
+  regex_literals *stack =
+      (regex_literals *)arena_alloc(mem, sizeof(regex_literals) * (len + 1));
+
+  if (stack == NULL)
+    return -1;
+
+  int top = -1;
+
+  for (int i = 0; i < len; i++) {
+    char c = postfix[i];
+
+    if (is_nfa_symbol(c)) {
+      regex_literals *l = &stack[++top];
+      l->exact = 1;
+      set_literal(l->prefix, &l->prefix_len, &c, 1);
+      set_literal(l->suffix, &l->suffix_len, &c, 1);
+      set_literal(l->required, &l->required_len, &c, 1);
+      alternates_from_required(l);
+    } else if (c == '*' && top >= 0) {
+      empty_literals(&stack[top], 0);
+    } else if ((c == '.' || c == '|') && top >= 1) {
+      if (c == '.')
+        concat_literals(&stack[top - 1], &stack[top - 1], &stack[top]);
+      else
+        alternate_literals(&stack[top - 1], &stack[top - 1], &stack[top]);
+
+      top--;
+    } else {
+      arena_release(mem, stack);
+      return -1;
+    }
+  }
+
+  if (top > 0) {
+    arena_release(mem, stack);
+    return -1;
+  }
+
+  // an empty regex only matches the empty string.
+  if (top == -1)
+    empty_literals(out, 1);
+  else
+    *out = stack[0];
+
+  out->scan_required =
+      !(out->required_len == out->prefix_len &&
+        memcmp(out->required, out->prefix, out->prefix_len) == 0) &&
+      !(out->required_len == out->suffix_len &&
+        memcmp(out->required, out->suffix, out->suffix_len) == 0);
+
+  out->scan_alternates = out->alternates_len > 1 &&
+                         shortest_alternate(out) > out->required_len;
+
+  arena_release(mem, stack);
+  return 0;
+}
+
+int literals_may_match(const regex_literals *l, const char *str,
+                       int str_len) {
+  if (l->exact)
+    return str_len == l->prefix_len &&
+           memcmp(str, l->prefix, l->prefix_len) == 0;
+
+  if (str_len < l->prefix_len || str_len < l->suffix_len)
+    return 0;
+
+  if (memcmp(str, l->prefix, l->prefix_len) != 0 ||
+      memcmp(str + str_len - l->suffix_len, l->suffix, l->suffix_len) != 0)
+    return 0;
+
+  if (l->scan_required && l->required_len > 0 &&
+      memmem(str, str_len, l->required, l->required_len) == NULL)
+    return 0;
+
+  return 1;
+}
+
+int find_literal_candidate(const regex_literals *l, const char *str,
+                           int str_len) {
+  int start = 0;
+
+  // every match starts with the prefix, so nothing before its first
+  // occurrence can be the start of one.
+  if (l->prefix_len > 0) {
+    const char *p;
+
+    if (l->prefix_len == 1)
+      p = (const char *)memchr(str, l->prefix[0], str_len);
+    else
+      p = (const char *)memmem(str, str_len, l->prefix, l->prefix_len);
+
+    if (p == NULL)
+      return -1;
+
+    start = p - str;
+  }
+
+  if (l->required_len > 0 && (l->prefix_len == 0 || l->scan_required) &&
+      memmem(str + start, str_len - start, l->required, l->required_len) ==
+          NULL)
+    return -1;
+
+  return start;
+}
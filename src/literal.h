@@ -0,0 +1,42 @@
+#ifndef LITERAL_H_
+#define LITERAL_H_
+
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LITERAL_MAX_LEN 32
+#define LITERAL_MAX_ALTERNATES 8
+
+// literals every string matched by a regex, or by a fragment of it while the
+// postfix is walked, starts with, ends with and contains. exact is set when
+// the regex matches prefix and nothing else. literals longer than
+// LITERAL_MAX_LEN are cut, which keeps them true. scan_required is cleared
+// when required is the prefix or the suffix, which are checked anyway.
+//
+// every match also contains one of the alternates, which is how
+// alternations like get|put|post are caught. scan_alternates is set when
+// they are more telling than required, since they need a teddy to look for.
+typedef struct regex_literals {
+  int exact;
+  int prefix_len;
+  int suffix_len;
+  int required_len;
+  int scan_required;
+  int alternates_len;
+  int scan_alternates;
+  char prefix[LITERAL_MAX_LEN];
+  char suffix[LITERAL_MAX_LEN];
+  char required[LITERAL_MAX_LEN];
+  int alternate_lens[LITERAL_MAX_ALTERNATES];
+  char alternates[LITERAL_MAX_ALTERNATES][LITERAL_MAX_LEN];
+} regex_literals;
+
+int find_regex_literals(const char *postfix, int len, regex_literals *out,
+                        arena *mem);
+int literals_may_match(const regex_literals *l, const char *str, int str_len);
+int find_literal_candidate(const regex_literals *l, const char *str,
+                           int str_len);
+
+#endif
@@ -1,7 +1,73 @@
+#include "grep.h"
 #include "regex.h"
 #include "util.h"
 
-int main() {
+// main.out -e PATTERN [-c] [-j THREADS] FILE... writes every line of the
+// files that the pattern is found in, or with -c how many there are, and
+// names the file before each of them when there is more than one. like grep
+// it exits with 0 when a line matched, 1 when none did and 2 on bad
+// arguments or when a file could not be searched, even if others matched.
+static int grep_main(int argc, char **argv) {
+  const char *pattern = NULL;
+  grep_options options;
+  int i = 1;
+
+  memset(&options, 0, sizeof(options));
+
+  for (; i < argc && argv[i][0] == '-'; i++) {
+    if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+      pattern = argv[++i];
+    } else if (strcmp(argv[i], "-c") == 0) {
+      options.count = 1;
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      options.threads = atoi(argv[++i]);
+    } else {
+      pattern = NULL;
+      break;
+    }
+  }
+
+  if (pattern == NULL || i == argc) {
+    fprintf(stderr, "Usage: %s -e PATTERN [-c] [-j THREADS] FILE...\n",
+            argv[0]);
+    return 2;
+  }
+
+  regex *r = regex_compile(pattern);
+
+  if (r == NULL) {
+    fprintf(stderr, "Could not compile '%s'\n", pattern);
+    return 2;
+  }
+
+  options.with_names = argc - i > 1;
+
+  int matched = 0;
+  int failed = 0;
+
+  for (; i < argc; i++) {
+    int matches = grep_file(r, argv[i], &options, stdout);
+
+    if (matches == -1) {
+      fprintf(stderr, "Could not search '%s'\n", argv[i]);
+      failed = 1;
+    } else if (matches > 0) {
+      matched = 1;
+    }
+  }
+
+  regex_free(r);
+
+  if (failed)
+    return 2;
+
+  return matched ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1)
+    return grep_main(argc, argv);
+
   char regex[1024];
   char str[1024];
 
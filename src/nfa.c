@@ -1,137 +1,182 @@
 #include "nfa.h"
 
-int evaluate_string_in_nfa(nfa *n, const char *str, int str_len) {
-  nfa_state_queue *q = new_nfa_state_queue(n->number_of_states * 2);
+nfa_scratch *new_nfa_scratch(const nfa *n, arena *mem) {
+  int states_len = n->number_of_states;
+  nfa_scratch *s = (nfa_scratch *)arena_alloc(mem, sizeof(nfa_scratch));
 
-  if (q == NULL)
-    return -1;
+  if (s == NULL)
+    return NULL;
 
-  nfa_state *curr = NULL;
+  s->mem = mem;
+  s->curr = new_sparse_set(states_len, mem);
+  s->next = new_sparse_set(states_len, mem);
+  s->curr_starts = (int *)arena_alloc(mem, sizeof(int) * states_len);
+  s->next_starts = (int *)arena_alloc(mem, sizeof(int) * states_len);
 
-  if (nfa_state_queue_enqueue(q, n->init) == -1) {
-    free_nfa_state_queue(q);
-    return -1;
+  if (s->curr == NULL || s->next == NULL || s->curr_starts == NULL ||
+      s->next_starts == NULL) {
+    free_nfa_scratch(s);
+    return NULL;
   }
 
-  int closures_len;
-  nfa_state **closures = NULL;
+  return s;
+}
 
-  int i = 0;
-  int closure_count = nfa_state_queue_length(q);
+void free_nfa_scratch(nfa_scratch *s) {
+  if (s == NULL)
+    return;
 
-  while (i < str_len) {
-    char c = str[i];
+  arena_release(s->mem, s->next_starts);
+  arena_release(s->mem, s->curr_starts);
+  if (s->next != NULL)
+    free_sparse_set(s->next);
+  if (s->curr != NULL)
+    free_sparse_set(s->curr);
+  arena_release(s->mem, s);
+}
 
-    if (nfa_state_queue_is_empty(q))
-      break;
+int evaluate_string_in_nfa(nfa *n, const char *str, int str_len, arena *mem) {
+  nfa_scratch *s = new_nfa_scratch(n, mem);
 
-    if (nfa_state_queue_dequeue(q, &curr) == -1) {
-      free_nfa_state_queue(q);
-      free(closures);
-      return -1;
-    }
+  if (s == NULL)
+    return -1;
 
-    if (closure_count > 0)
-      closure_count--;
+  int evaluated = evaluate_string_in_nfa_with(n, s, str, str_len);
 
-    closures =
-        find_epsilon_closures_without_final_states(n, curr, &closures_len);
+  free_nfa_scratch(s);
+  return evaluated;
+}
 
-    int transitions_found = 0;
+int evaluate_string_in_nfa_with(nfa *n, nfa_scratch *scratch,
+                                const char *str, int str_len) {
+  sparse_set *curr = scratch->curr;
+  sparse_set *next = scratch->next;
 
-    for (int j = 0; j < closures_len; j++) {
-      nfa_state *closure = closures[j];
+  sparse_set_clear(curr);
+  add_nfa_state_to_set(n, curr, n->init);
 
-      if (closure->next != NULL && closure->symbol == c) {
-        nfa_state_queue_enqueue(q, closure->next);
-        transitions_found = 1;
-      }
-    }
+  for (int i = 0; i < str_len && curr->len > 0; i++) {
+    step_nfa_set(n, curr, next, str[i]);
 
-    free(closures);
+    sparse_set *temp = curr;
+    curr = next;
+    next = temp;
+  }
 
-    if (closure_count == 0) {
-      closure_count = nfa_state_queue_length(q);
-      i++;
+  return sparse_set_contains(curr, n->final);
+}
 
-      if (closure_count == 0 && !transitions_found) {
-        free_nfa_state_queue(q);
-        return 0;
-      }
-    }
-  }
+static void add_nfa_state_from(nfa *n, sparse_set *set, int *starts, int s,
+                               int start) {
+  int len = set->len;
 
-  if (i < str_len) {
-    free_nfa_state_queue(q);
-    return 0;
-  }
+  add_nfa_state_to_set(n, set, s);
+
+  for (int i = len; i < set->len; i++)
+    starts[set->dense[i]] = start;
+}
+
+int search_string_in_nfa(nfa *n, const char *str, int str_len, int max_start,
+                         int *start, int *end, arena *mem) {
+  nfa_scratch *s = new_nfa_scratch(n, mem);
+
+  if (s == NULL)
+    return -1;
 
-  while (curr != NULL || !nfa_state_queue_is_empty(q)) {
-    closures = find_epsilon_closures(n, curr, &closures_len);
+  int found =
+      search_string_in_nfa_with(n, s, str, str_len, max_start, start, end);
 
-    for (int i = 0; i < closures_len; i++) {
-      nfa_state *closure = closures[i];
+  free_nfa_scratch(s);
+  return found;
+}
 
-      if (closure->id == n->final->id) {
-        free_nfa_state_queue(q);
-        free(closures);
-        return 1;
+int search_string_in_nfa_with(nfa *n, nfa_scratch *scratch, const char *str,
+                              int str_len, int max_start, int *start,
+                              int *end) {
+  sparse_set *curr = scratch->curr;
+  sparse_set *next = scratch->next;
+  int *curr_starts = scratch->curr_starts;
+  int *next_starts = scratch->next_starts;
+  int best_start = -1;
+  int best_end = -1;
+
+  sparse_set_clear(curr);
+
+  // threads are stepped in the order they entered the set and a new one is
+  // only started after all the others, so a state always carries the
+  // leftmost start that reaches it. once there is a match, threads that
+  // started after it can be dropped and no new ones are started.
+  for (int i = 0;; i++) {
+    if (best_start == -1 && i <= max_start)
+      add_nfa_state_from(n, curr, curr_starts, n->init, i);
+
+    if (sparse_set_contains(curr, n->final)) {
+      int s = curr_starts[n->final];
+
+      if (best_start == -1 || s <= best_start) {
+        best_start = s;
+        best_end = i;
       }
     }
 
-    free(closures);
+    if (i == str_len)
+      break;
 
-    if (nfa_state_queue_is_empty(q))
+    if (curr->len == 0 && (best_start != -1 || i >= max_start))
       break;
 
-    if (nfa_state_queue_dequeue(q, &curr) == -1) {
-      free_nfa_state_queue(q);
-      return -1;
+    sparse_set_clear(next);
+
+    for (int j = 0; j < curr->len; j++) {
+      int from = curr->dense[j];
+      nfa_state *state = &n->states[from];
+
+      if (best_start != -1 && curr_starts[from] > best_start)
+        continue;
+
+      // epsilon states have no symbol, which a nul byte must not match.
+      if (state->symbol != '\0' && state->symbol == str[i] &&
+          state->next != NFA_NO_STATE)
+        add_nfa_state_from(n, next, next_starts, state->next,
+                           curr_starts[from]);
     }
+
+    sparse_set *temp = curr;
+    curr = next;
+    next = temp;
+
+    int *temp_starts = curr_starts;
+    curr_starts = next_starts;
+    next_starts = temp_starts;
   }
 
-  free_nfa_state_queue(q);
-  return 0;
+  if (best_start != -1) {
+    *start = best_start;
+    *end = best_end;
+  }
+
+  return best_start != -1;
 }
 
-nfa *new_nfa_from_regex(const char *regex, int len) {
-  int count = 0;
+// with reverse set the fragment matches the reversed strings, which only
+// swaps the two sides of every concatenation.
+static int build_nfa_fragment(nfa *n, nfa_stack *s, const char *regex,
+                              int len, int reverse, nfa_fragment *out) {
   int transition_err = 0;
-  nfa_stack *s = new_nfa_stack(len);
-
-  if (s == NULL)
-    return NULL;
 
   // if regex is empty, then we have a epsilon regex, which is just
   // a epsilon transition from init state to final state.
   if (len == 0) {
-    nfa n;
-    nfa_state *init = new_nfa_state(count++);
-    if (init == NULL) {
-      free_nfa_stack(s);
-      return NULL;
-    }
+    nfa_fragment f;
+    f.init = new_nfa_state(n);
+    f.final = new_nfa_state(n);
 
-    nfa_state *final = new_nfa_state(count++);
-    if (final == NULL) {
-      free(init);
-      free_nfa_stack(s);
-      return NULL;
-    }
+    transition_err = add_epsilon_nfa_transition(n, f.init, f.final);
 
-    transition_err = add_epsilon_nfa_transition(init, final);
-    if (transition_err == -1) {
-      free(init);
-      free(final);
-      free_nfa_stack(s);
-      return NULL;
-    }
-
-    n.init = init;
-    n.final = final;
-    n.number_of_states = 2;
+    if (transition_err == -1)
+      return -1;
 
-    nfa_stack_push(s, n);
+    nfa_stack_push(s, f);
   }
 
   int i = 0;
@@ -139,541 +184,538 @@ nfa *new_nfa_from_regex(const char *regex, int len) {
     char c = regex[i];
     i++;
 
-    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
-        (c >= '0' && c <= '9')) {
-      nfa n;
-      nfa_state *init = new_nfa_state(count++);
-      if (init == NULL) {
-        free_nfa_stack(s);
-        return NULL;
-      }
+    if (is_nfa_symbol(c)) {
+      nfa_fragment f;
+      f.init = new_nfa_state(n);
+      f.final = new_nfa_state(n);
 
-      nfa_state *final = new_nfa_state(count++);
-      if (final == NULL) {
-        free(init);
-        free_nfa_stack(s);
-        return NULL;
-      }
+      transition_err = add_nfa_transition(n, f.init, f.final, c);
 
-      transition_err = add_nfa_transition(init, final, c);
+      if (transition_err == -1)
+        return -1;
 
-      if (transition_err == -1) {
-        free(init);
-        free(final);
-        free_nfa_stack(s);
-        return NULL;
-      }
+      nfa_stack_push(s, f);
+    } else if (c == '*') {
+      nfa_fragment last;
 
-      n.init = init;
-      n.final = final;
-      n.number_of_states = 2;
+      if (nfa_stack_pop(s, &last) == -1)
+        return -1;
 
-      nfa_stack_push(s, n);
-    } else if (c == '*') {
-      nfa last;
+      // the loop gets its own init and final states, so the fragment's
+      // final state never has an outgoing transition when it is joined with
+      // another fragment.
+      nfa_fragment f;
+      f.init = new_nfa_state(n);
+      f.final = new_nfa_state(n);
 
-      if (nfa_stack_is_empty(s)) {
-        free_nfa_stack(s);
-        return NULL;
-      }
+      transition_err |= add_epsilon_nfa_transition(n, f.init, last.init);
+      transition_err |= add_epsilon_nfa_transition(n, f.init, f.final);
+      transition_err |= add_epsilon_nfa_transition(n, last.final, last.init);
+      transition_err |= add_epsilon_nfa_transition(n, last.final, f.final);
 
-      nfa_stack_pop(s, &last);
-
-      nfa n;
-
-      if ((last.final->epsilon != NULL && last.final->next != NULL) ||
-          (last.init->epsilon != NULL && last.init->next != NULL)) {
-        nfa_state *new_state = new_nfa_state(count++);
-        if (new_state == NULL) {
-          free_nfa_stack(s);
-          return NULL;
-        }
-
-        transition_err = add_epsilon_nfa_transition(new_state, last.init);
-        transition_err = add_epsilon_nfa_transition(new_state, last.final);
-        transition_err = add_epsilon_nfa_transition(last.final, new_state);
-
-        if (transition_err == -1) {
-          free_nfa_stack(s);
-          free(new_state);
-          return NULL;
-        }
-
-        n.init = new_state;
-        n.final = last.final;
-        n.number_of_states = last.number_of_states + 1;
-      } else {
-        transition_err = add_epsilon_nfa_transition(last.final, last.init);
-        transition_err = add_epsilon_nfa_transition(last.init, last.final);
-
-        if (transition_err == -1) {
-          free_nfa_stack(s);
-          return NULL;
-        }
-
-        n.init = last.init;
-        n.final = last.final;
-        n.number_of_states = last.number_of_states;
-      }
+      if (transition_err == -1)
+        return -1;
 
-      nfa_stack_push(s, n);
+      nfa_stack_push(s, f);
     } else if (c == '.') {
-      nfa l1;
-      nfa l2;
-
-      if (nfa_stack_is_empty(s)) {
-        free_nfa_stack(s);
-        return NULL;
-      }
+      nfa_fragment l1;
+      nfa_fragment l2;
 
-      nfa_stack_pop(s, &l1);
+      if (nfa_stack_pop(s, &l1) == -1 || nfa_stack_pop(s, &l2) == -1)
+        return -1;
 
-      if (nfa_stack_is_empty(s)) {
-        free_nfa_stack(s);
-        return NULL;
+      if (reverse) {
+        nfa_fragment tmp = l1;
+        l1 = l2;
+        l2 = tmp;
       }
 
-      nfa_stack_pop(s, &l2);
+      transition_err = add_epsilon_nfa_transition(n, l2.final, l1.init);
 
-      nfa n;
-      transition_err = add_epsilon_nfa_transition(l2.final, l1.init);
+      if (transition_err == -1)
+        return -1;
 
-      if (transition_err == -1) {
-        free_nfa_stack(s);
-        return NULL;
-      }
-
-      n.init = l2.init;
-      n.final = l1.final;
-      n.number_of_states = l1.number_of_states + l2.number_of_states;
-      nfa_stack_push(s, n);
+      nfa_fragment f;
+      f.init = l2.init;
+      f.final = l1.final;
+      nfa_stack_push(s, f);
     } else if (c == '|') {
-      nfa l1;
-      nfa l2;
+      nfa_fragment l1;
+      nfa_fragment l2;
 
-      if (nfa_stack_is_empty(s)) {
-        free_nfa_stack(s);
-        return NULL;
-      }
+      if (nfa_stack_pop(s, &l1) == -1 || nfa_stack_pop(s, &l2) == -1)
+        return -1;
 
-      nfa_stack_pop(s, &l1);
+      nfa_fragment f;
+      f.init = new_nfa_state(n);
+      f.final = new_nfa_state(n);
 
-      if (nfa_stack_is_empty(s)) {
-        free_nfa_stack(s);
-        return NULL;
-      }
+      transition_err |= add_epsilon_nfa_transition(n, f.init, l2.init);
+      transition_err |= add_epsilon_nfa_transition(n, f.init, l1.init);
+      transition_err |= add_epsilon_nfa_transition(n, l2.final, f.final);
+      transition_err |= add_epsilon_nfa_transition(n, l1.final, f.final);
 
-      nfa_stack_pop(s, &l2);
+      if (transition_err == -1)
+        return -1;
 
-      nfa n;
-      nfa_state *init = new_nfa_state(count++);
-      if (init == NULL) {
-        free_nfa_stack(s);
-        return NULL;
-      }
+      nfa_stack_push(s, f);
+    } else {
+      return -1;
+    }
+  }
 
-      nfa_state *final = new_nfa_state(count++);
-      if (final == NULL) {
-        free(init);
-        free_nfa_stack(s);
-        return NULL;
-      }
+  if (nfa_stack_pop(s, out) == -1 || !nfa_stack_is_empty(s))
+    return -1;
 
-      transition_err = add_epsilon_nfa_transition(init, l1.init);
-      transition_err = add_epsilon_nfa_transition(init, l2.init);
-      transition_err = add_epsilon_nfa_transition(l2.final, final);
-      transition_err = add_epsilon_nfa_transition(l1.final, final);
+  return 0;
+}
 
-      if (transition_err == -1) {
-        free(init);
-        free(final);
-        free_nfa_stack(s);
-        return NULL;
-      }
+static nfa *build_nfa(const char *regex, int len, int reverse, arena *mem) {
+  // every postfix symbol adds at most two states, and an empty regex needs
+  // two states of its own.
+  nfa *n = new_nfa(len * 2 + 2, mem);
 
-      n.init = init;
-      n.final = final;
-      n.number_of_states = l1.number_of_states + l2.number_of_states + 2;
-      nfa_stack_push(s, n);
-    } else {
-      free_nfa_stack(s);
-      return NULL;
-    }
+  if (n == NULL)
+    return NULL;
+
+  nfa_stack *s = new_nfa_stack(len + 1, mem);
+
+  if (s == NULL) {
+    free_nfa(n);
+    return NULL;
   }
 
-  if (nfa_stack_is_empty(s)) {
+  nfa_fragment f;
+
+  if (build_nfa_fragment(n, s, regex, len, reverse, &f) == -1) {
     free_nfa_stack(s);
+    free_nfa(n);
     return NULL;
   }
 
-  nfa *n = (nfa *)malloc(sizeof(nfa));
-  nfa_stack_pop(s, n);
+  n->init = f.init;
+  n->final = f.final;
 
-  if (!nfa_stack_is_empty(s)) {
+  free_nfa_stack(s);
+
+  if (find_all_epsilon_closures(n, mem) == -1) {
     free_nfa(n);
-    free_nfa_stack(s);
     return NULL;
   }
 
-  free_nfa_stack(s);
+  find_byte_classes(n);
+
   return n;
 }
 
-nfa_state *new_nfa_state(int id) {
-  nfa_state *state = (nfa_state *)malloc(sizeof(nfa_state));
+nfa *new_nfa_from_regex(const char *regex, int len, arena *mem) {
+  return build_nfa(regex, len, 0, mem);
+}
 
-  if (state == NULL)
-    return NULL;
+// the nfa of the reversed pattern, which accepts a string when the pattern
+// accepts it read backwards.
+nfa *new_reverse_nfa_from_regex(const char *regex, int len, arena *mem) {
+  return build_nfa(regex, len, 1, mem);
+}
 
-  state->id = id;
-  state->symbol = '\0';
-  state->next = NULL;
-  state->epsilon = NULL;
+nfa *new_nfa_from_regexes(const char **regexes, const int *lens, int count,
+                          arena *mem) {
+  int max_states = 0;
+  int max_len = 0;
 
-  return state;
-}
+  for (int i = 0; i < count; i++) {
+    max_states += lens[i] * 2 + 2;
 
-nfa_state **find_epsilon_closures(nfa *n, nfa_state *s, int *closures_len) {
-  nfa_state_stack *state_stack = new_nfa_state_stack(n->number_of_states * 2);
+    if (lens[i] > max_len)
+      max_len = lens[i];
+  }
 
-  if (state_stack == NULL)
+  // one more state per pattern chains the fragments to the shared init.
+  nfa *n = new_nfa(max_states + count, mem);
+
+  if (n == NULL)
     return NULL;
 
-  int len = 0;
-  int max_closures = 5;
-  nfa_state **closures =
-      (nfa_state **)malloc(sizeof(nfa_state *) * max_closures);
+  nfa_stack *s = new_nfa_stack(max_len + 1, mem);
+  n->pattern_ids = (int *)arena_alloc(mem, sizeof(int) * n->max_states);
 
-  if (closures == NULL) {
-    free_nfa_state_stack(state_stack);
+  if (s == NULL || n->pattern_ids == NULL) {
+    if (s != NULL)
+      free_nfa_stack(s);
+    free_nfa(n);
     return NULL;
   }
 
-  nfa_state *prev = NULL;
-  nfa_state *curr = s;
-  int curr_epsilon_transitions_len;
+  for (int i = 0; i < n->max_states; i++)
+    n->pattern_ids[i] = NFA_NO_STATE;
 
-  int err = 0;
-  while (curr != NULL) {
-    nfa_state **epsilons = epsilons =
-        get_epsilon_transitions(curr, &curr_epsilon_transitions_len);
+  // every link of the chain has an epsilon transition into one pattern and
+  // one to the next link, the last link leads nowhere else.
+  int link = new_nfa_state(n);
+  n->init = link;
 
-    if (epsilons == NULL) {
-      free_nfa_state_stack(state_stack);
-      free(closures);
-      free(epsilons);
+  for (int i = 0; i < count; i++) {
+    nfa_fragment f;
+
+    if (build_nfa_fragment(n, s, regexes[i], lens[i], 0, &f) == -1) {
+      free_nfa_stack(s);
+      free_nfa(n);
       return NULL;
     }
 
-    if (curr->id == n->final->id ||
-        (curr->symbol != '\0' && curr->next != NULL)) {
-
-      int is_state_already_exists_in_closures = 0;
-
-      for (int i = 0; i < len; i++) {
-        if (closures[i]->id == curr->id) {
-          is_state_already_exists_in_closures = 1;
-        }
-      }
-
-      if (!is_state_already_exists_in_closures) {
-        if (append_to_closures(curr, &closures, &len, &max_closures) == -1) {
-          free_nfa_state_stack(state_stack);
-          free(epsilons);
-          free(closures);
-          return NULL;
-        }
-      }
-    }
+    n->pattern_ids[f.final] = i;
+    add_epsilon_nfa_transition(n, link, f.init);
 
-    for (int i = 0; i < curr_epsilon_transitions_len; i++) {
-      nfa_state *e = epsilons[i];
-
-      if (prev == NULL || e->id != prev->id) {
-        err = nfa_state_stack_push(state_stack, curr);
-        err = nfa_state_stack_push(state_stack, e);
-        if (err == -1) {
-          free_nfa_state_stack(state_stack);
-          free(closures);
-          free(epsilons);
-          return NULL;
-        }
-      }
+    if (i < count - 1) {
+      int next = new_nfa_state(n);
+      add_epsilon_nfa_transition(n, link, next);
+      link = next;
     }
+  }
 
-    free(epsilons);
+  free_nfa_stack(s);
 
-    if (!nfa_state_stack_is_empty(state_stack)) {
-      err = nfa_state_stack_pop(state_stack, &curr);
-      err = nfa_state_stack_pop(state_stack, &prev);
-      if (err == -1) {
-        free_nfa_state_stack(state_stack);
-        free(closures);
-        free(epsilons);
-        return NULL;
-      }
-    } else {
-      break;
-    }
+  if (find_all_epsilon_closures(n, mem) == -1) {
+    free_nfa(n);
+    return NULL;
   }
 
-  *closures_len = len;
-  free_nfa_state_stack(state_stack);
+  find_byte_classes(n);
 
-  return closures;
+  return n;
 }
 
-nfa_state **find_epsilon_closures_without_final_states(nfa *n, nfa_state *s,
-                                                       int *closures_len) {
-  nfa_state_stack *state_stack = new_nfa_state_stack(n->number_of_states * 2);
+int is_nfa_final(const nfa *n, int s) {
+  return s == n->final ||
+         (n->pattern_ids != NULL && n->pattern_ids[s] != NFA_NO_STATE);
+}
 
-  if (state_stack == NULL)
+int is_nfa_symbol(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9');
+}
+
+nfa *new_nfa(int max_states, arena *mem) {
+  nfa *n =
+      (nfa *)arena_alloc(mem, sizeof(nfa) + sizeof(nfa_state) * max_states);
+
+  if (n == NULL)
     return NULL;
 
-  int len = 0;
-  int max_closures = 5;
-  nfa_state **closures =
-      (nfa_state **)malloc(sizeof(nfa_state *) * max_closures);
+  n->number_of_states = 0;
+  n->max_states = max_states;
+  n->init = NFA_NO_STATE;
+  n->final = NFA_NO_STATE;
+  n->states = (nfa_state *)(n + 1);
+  n->number_of_classes = 1;
+  memset(n->byte_classes, 0, sizeof(n->byte_classes));
+  n->closure_offsets = NULL;
+  n->closures = NULL;
+  n->number_of_closures = 0;
+  n->pattern_ids = NULL;
+  n->mem = mem;
 
-  if (closures == NULL) {
-    free_nfa_state_stack(state_stack);
+  return n;
+}
+
+nfa *copy_nfa(const nfa *n, arena *mem) {
+  nfa *copy = new_nfa(n->max_states, mem);
+
+  if (copy == NULL)
     return NULL;
-  }
 
-  nfa_state *prev = NULL;
-  nfa_state *curr = s;
-  int curr_epsilon_transitions_len;
+  copy->number_of_states = n->number_of_states;
+  copy->init = n->init;
+  copy->final = n->final;
+  copy->number_of_classes = n->number_of_classes;
+  copy->number_of_closures = n->number_of_closures;
+  memcpy(copy->byte_classes, n->byte_classes, sizeof(n->byte_classes));
+  memcpy(copy->states, n->states, sizeof(nfa_state) * n->number_of_states);
 
-  int err = 0;
-  while (curr != NULL) {
-    nfa_state **epsilons =
-        get_epsilon_transitions(curr, &curr_epsilon_transitions_len);
+  if (n->pattern_ids != NULL) {
+    copy->pattern_ids = (int *)arena_alloc(mem, sizeof(int) * n->max_states);
 
-    if (epsilons == NULL) {
-      free_nfa_state_stack(state_stack);
-      free(closures);
-      free(epsilons);
+    if (copy->pattern_ids == NULL) {
+      free_nfa(copy);
       return NULL;
     }
 
-    if (curr->symbol != '\0' && curr->next != NULL) {
+    memcpy(copy->pattern_ids, n->pattern_ids, sizeof(int) * n->max_states);
+  }
 
-      int is_state_already_exists_in_closures = 0;
+  if (n->closure_offsets == NULL)
+    return copy;
 
-      for (int i = 0; i < len; i++) {
-        if (closures[i]->id == curr->id) {
-          is_state_already_exists_in_closures = 1;
-        }
-      }
+  int offsets_len = n->number_of_states + 1;
+  int closures_len = n->closure_offsets[n->number_of_states];
 
-      if (!is_state_already_exists_in_closures) {
-        if (append_to_closures(curr, &closures, &len, &max_closures) == -1) {
-          free_nfa_state_stack(state_stack);
-          free(closures);
-          free(epsilons);
-          return NULL;
-        }
-      }
-    }
+  copy->closure_offsets = (int *)arena_alloc(mem, sizeof(int) * offsets_len);
+  copy->closures = (int *)arena_alloc(mem, sizeof(int) * (closures_len + 1));
 
-    for (int i = 0; i < curr_epsilon_transitions_len; i++) {
-      nfa_state *e = epsilons[i];
-
-      if (prev == NULL || e->id != prev->id) {
-        err = nfa_state_stack_push(state_stack, curr);
-        err = nfa_state_stack_push(state_stack, epsilons[i]);
-        if (err == -1) {
-          free_nfa_state_stack(state_stack);
-          free(closures);
-          free(epsilons);
-          return NULL;
-        }
-      }
+  if (copy->closure_offsets == NULL || copy->closures == NULL) {
+    free_nfa(copy);
+    return NULL;
+  }
+
+  memcpy(copy->closure_offsets, n->closure_offsets, sizeof(int) * offsets_len);
+  memcpy(copy->closures, n->closures, sizeof(int) * closures_len);
+
+  return copy;
+}
+
+int new_nfa_state(nfa *n) {
+  if (n->number_of_states >= n->max_states)
+    return NFA_NO_STATE;
+
+  int id = n->number_of_states++;
+  n->states[id].symbol = '\0';
+  n->states[id].next = NFA_NO_STATE;
+  n->states[id].epsilon = NFA_NO_STATE;
+
+  return id;
+}
+
+static int walk_epsilon_closure(nfa *n, int s, int *visited,
+                                nfa_state_stack *state_stack, int *out) {
+  int len = 0;
+  int curr;
+  int epsilons[2];
+
+  visited[s] = s;
+  nfa_state_stack_push(state_stack, s);
+
+  while (nfa_state_stack_pop(state_stack, &curr) == 0) {
+    if (is_nfa_final(n, curr) || n->states[curr].symbol != '\0') {
+      if (out != NULL)
+        out[len] = curr;
+
+      len++;
     }
 
-    free(epsilons);
+    int epsilons_len = get_epsilon_transitions(n, curr, epsilons);
 
-    if (!nfa_state_stack_is_empty(state_stack)) {
-      err = nfa_state_stack_pop(state_stack, &curr);
-      err = nfa_state_stack_pop(state_stack, &prev);
-      if (err == -1) {
-        free_nfa_state_stack(state_stack);
-        free(closures);
-        return NULL;
+    for (int i = 0; i < epsilons_len; i++) {
+      if (visited[epsilons[i]] != s) {
+        visited[epsilons[i]] = s;
+        nfa_state_stack_push(state_stack, epsilons[i]);
       }
-    } else {
-      break;
     }
   }
 
-  *closures_len = len;
-  free_nfa_state_stack(state_stack);
-
-  return closures;
+  return len;
 }
 
-int add_nfa_transition(nfa_state *from, nfa_state *to, char symbol) {
-  if (from == NULL || to == NULL)
-    return -1;
-  if (from->next != NULL)
+int find_all_epsilon_closures(nfa *n, arena *mem) {
+  int states_len = n->number_of_states;
+
+  nfa_state_stack *state_stack = new_nfa_state_stack(states_len, mem);
+
+  if (state_stack == NULL)
     return -1;
 
-  from->next = to;
-  from->symbol = symbol;
-  return 0;
-}
+  int *visited = (int *)arena_alloc(mem, sizeof(int) * states_len);
+  char *is_entry = (char *)arena_alloc(mem, states_len);
+  int *offsets = (int *)arena_alloc(mem, sizeof(int) * (states_len + 1));
 
-int add_epsilon_nfa_transition(nfa_state *from, nfa_state *to) {
-  if (from == NULL || to == NULL)
+  if (visited == NULL || is_entry == NULL || offsets == NULL) {
+    arena_release(mem, offsets);
+    arena_release(mem, is_entry);
+    arena_release(mem, visited);
+    free_nfa_state_stack(state_stack);
     return -1;
-  if (from->epsilon != NULL) {
-    return add_nfa_transition(from, to, '\0');
   }
 
-  from->epsilon = to;
-  return 0;
-}
-
-int append_to_closures(nfa_state *closure_state, nfa_state ***closures,
-                       int *len, int *max) {
-  if ((*max) - 1 <= (*len)) {
-    *max *= 2;
-    nfa_state **temp =
-        (nfa_state **)realloc(*closures, sizeof(nfa_state *) * (*max));
+  memset(is_entry, 0, states_len);
+  is_entry[n->init] = 1;
 
-    if (temp == NULL)
-      return -1;
+  for (int i = 0; i < states_len; i++) {
+    visited[i] = NFA_NO_STATE;
 
-    *closures = temp;
+    if (n->states[i].symbol != '\0' && n->states[i].next != NFA_NO_STATE)
+      is_entry[n->states[i].next] = 1;
   }
 
-  (*closures)[(*len)++] = closure_state;
-  return 0;
-}
+  // the first walk only counts, so the closures can be laid out in a single
+  // allocation by the second one.
+  int total = 0;
 
-nfa_state **get_epsilon_transitions(nfa_state *s, int *transitions_len) {
-  int i = 0;
-  nfa_state **transitions = (nfa_state **)malloc(sizeof(nfa_state *) * 2);
+  for (int i = 0; i < states_len; i++) {
+    offsets[i] = total;
 
-  if (transitions == NULL)
-    return NULL;
+    if (is_entry[i])
+      total += walk_epsilon_closure(n, i, visited, state_stack, NULL);
+  }
 
-  if (s->epsilon != NULL) {
-    transitions[i++] = s->epsilon;
+  offsets[states_len] = total;
+
+  int *closures = (int *)arena_alloc(mem, sizeof(int) * (total + 1));
+
+  if (closures == NULL) {
+    arena_release(mem, offsets);
+    arena_release(mem, is_entry);
+    arena_release(mem, visited);
+    free_nfa_state_stack(state_stack);
+    return -1;
   }
 
-  if (s->symbol == '\0' && s->next != NULL) {
-    transitions[i++] = s->next;
+  for (int i = 0; i < states_len; i++)
+    visited[i] = NFA_NO_STATE;
+
+  n->number_of_closures = 0;
+
+  for (int i = 0; i < states_len; i++) {
+    if (is_entry[i]) {
+      walk_epsilon_closure(n, i, visited, state_stack, closures + offsets[i]);
+      n->number_of_closures++;
+    }
   }
 
-  *transitions_len = i;
-  return transitions;
-}
+  n->closure_offsets = offsets;
+  n->closures = closures;
 
-void free_nfa(nfa *n) {
-  int *visited = (int *)malloc(sizeof(int) * n->number_of_states);
-  for (int i = 0; i < n->number_of_states; i++)
-    visited[i] = 0;
+  arena_release(mem, is_entry);
+  arena_release(mem, visited);
+  free_nfa_state_stack(state_stack);
 
-  free_nfa_state(n->init, visited, n->number_of_states);
-  free(visited);
-  free(n);
+  return 0;
 }
 
-void free_nfa_state(nfa_state *s, int *visited, int visited_len) {
-  if (s == NULL || s->id >= visited_len || visited[s->id] == 1)
-    return;
+void find_byte_classes(nfa *n) {
+  char is_symbol[NFA_ALPHABET_SIZE];
+  memset(is_symbol, 0, sizeof(is_symbol));
 
-  visited[s->id] = 1;
-
-  if (s->next != NULL && s->epsilon != NULL) {
-    if (s->next->id == s->epsilon->id) {
-      free_nfa_state(s->next, visited, visited_len);
-    } else {
-      free_nfa_state(s->next, visited, visited_len);
-      free_nfa_state(s->epsilon, visited, visited_len);
-    }
-  } else if (s->next != NULL) {
-    free_nfa_state(s->next, visited, visited_len);
-  } else {
-    free_nfa_state(s->epsilon, visited, visited_len);
+  for (int i = 0; i < n->number_of_states; i++) {
+    if (n->states[i].symbol != '\0')
+      is_symbol[(unsigned char)n->states[i].symbol] = 1;
   }
 
-  free(s);
-  s = NULL;
+  // a transition reads exactly one byte, so every byte read by some
+  // transition is a class of its own and all the other bytes, which can
+  // only lead to the dead state, are class 0.
+  n->number_of_classes = 1;
+
+  for (int c = 0; c < NFA_ALPHABET_SIZE; c++)
+    n->byte_classes[c] = is_symbol[c] ? n->number_of_classes++ : 0;
 }
 
-void print_nfa(nfa *nfa) {
-  printf("NFA:\n");
-  printf("Initial State -> %i\n", nfa->init->id);
-  printf("Final State -> %i\n", nfa->final->id);
-  printf("-----------------------------------------\n");
-  int *visited = (int *)malloc(sizeof(int) * nfa->number_of_states);
+const int *get_epsilon_closures(nfa *n, int s, int *closures_len) {
+  *closures_len = n->closure_offsets[s + 1] - n->closure_offsets[s];
+  return n->closures + n->closure_offsets[s];
+}
 
-  if (visited == NULL) {
-    printf("ERROR ON PRINTING NFA\n");
-    return;
+// s is init or the target of a symbol transition, so its closure is already
+// on the nfa and nothing is walked while matching.
+void add_nfa_state_to_set(nfa *n, sparse_set *set, int s) {
+  int closures_len;
+  const int *closures = get_epsilon_closures(n, s, &closures_len);
+
+  for (int i = 0; i < closures_len; i++)
+    sparse_set_add(set, closures[i]);
+}
+
+void step_nfa_set(nfa *n, sparse_set *curr, sparse_set *next, char c) {
+  sparse_set_clear(next);
+
+  // every state enters a set at most once per character, so a step costs at
+  // most the number of states no matter how the pattern nests.
+  for (int j = 0; j < curr->len; j++) {
+    nfa_state *state = &n->states[curr->dense[j]];
+
+    // epsilon states have no symbol, which a nul byte must not match.
+    if (state->symbol != '\0' && state->symbol == c &&
+        state->next != NFA_NO_STATE)
+      add_nfa_state_to_set(n, next, state->next);
   }
+}
 
-  for (int i = 0; i < nfa->number_of_states; i++)
-    visited[i] = 0;
+int add_nfa_transition(nfa *n, int from, int to, char symbol) {
+  if (from == NFA_NO_STATE || to == NFA_NO_STATE)
+    return -1;
+  if (n->states[from].next != NFA_NO_STATE)
+    return -1;
 
-  print_nfa_state(nfa->init, visited);
-  free(visited);
+  n->states[from].next = to;
+  n->states[from].symbol = symbol;
+  return 0;
 }
 
-void print_nfa_state(nfa_state *state, int *visited) {
-  if (visited[state->id] != 0) {
-    return;
+int add_epsilon_nfa_transition(nfa *n, int from, int to) {
+  if (from == NFA_NO_STATE || to == NFA_NO_STATE)
+    return -1;
+  if (n->states[from].epsilon != NFA_NO_STATE) {
+    return add_nfa_transition(n, from, to, '\0');
   }
 
-  printf("q%i     ", state->id);
+  n->states[from].epsilon = to;
+  return 0;
+}
 
-  if (state->symbol != '\0' && state->next != NULL) {
-    printf(" | %c -> q%i | ", state->symbol, state->next->id);
-  }
+int get_epsilon_transitions(nfa *n, int s, int *transitions) {
+  int i = 0;
+  nfa_state *state = &n->states[s];
 
-  if (state->symbol == '\0' && state->next != NULL) {
-    printf(" | eps -> q%i | ", state->next->id);
+  if (state->epsilon != NFA_NO_STATE) {
+    transitions[i++] = state->epsilon;
   }
 
-  if (state->epsilon != NULL) {
-    printf(" | eps -> q%i | ", state->epsilon->id);
+  if (state->symbol == '\0' && state->next != NFA_NO_STATE) {
+    transitions[i++] = state->next;
   }
 
-  visited[state->id] = 1;
+  return i;
+}
+
+void free_nfa(nfa *n) {
+  arena_release(n->mem, n->pattern_ids);
+  arena_release(n->mem, n->closures);
+  arena_release(n->mem, n->closure_offsets);
+  arena_release(n->mem, n);
+}
+
+void print_nfa(nfa *nfa) {
+  printf("NFA:\n");
+  printf("Initial State -> %i\n", nfa->init);
+  printf("Final State -> %i\n", nfa->final);
+  printf("-----------------------------------------\n");
+
+  for (int i = 0; i < nfa->number_of_states; i++) {
+    nfa_state *state = &nfa->states[i];
+
+    printf("q%i     ", i);
+
+    if (state->symbol != '\0' && state->next != NFA_NO_STATE) {
+      printf(" | %c -> q%i | ", state->symbol, state->next);
+    }
+
+    if (state->symbol == '\0' && state->next != NFA_NO_STATE) {
+      printf(" | eps -> q%i | ", state->next);
+    }
+
+    if (state->epsilon != NFA_NO_STATE) {
+      printf(" | eps -> q%i | ", state->epsilon);
+    }
+
+    if (state->next == NFA_NO_STATE && state->epsilon == NFA_NO_STATE) {
+      printf(" | NULL | ");
+    }
 
-  if (state->next != NULL && state->epsilon != NULL &&
-      state->epsilon->id != state->next->id) {
-    printf("\n");
-    print_nfa_state(state->next, visited);
-    print_nfa_state(state->epsilon, visited);
-  } else if (state->next != NULL) {
-    printf("\n");
-    print_nfa_state(state->next, visited);
-  } else if (state->epsilon != NULL) {
-    printf("\n");
-    print_nfa_state(state->epsilon, visited);
-  } else {
-    printf(" | NULL | ");
     printf("\n");
-    return;
   }
 }
 
-nfa_stack *new_nfa_stack(int max) {
-  nfa_stack *s = (nfa_stack *)malloc(sizeof(nfa_stack));
+nfa_stack *new_nfa_stack(int max, arena *mem) {
+  nfa_stack *s = (nfa_stack *)arena_alloc(mem, sizeof(nfa_stack));
 
   if (s == NULL)
     return NULL;
 
-  s->data = (nfa *)malloc(sizeof(nfa) * max);
+  s->data = (nfa_fragment *)arena_alloc(mem, sizeof(nfa_fragment) * max);
+  s->mem = mem;
   s->top = -1;
   s->max = max;
 
   if (s->data == NULL) {
-    if (s != NULL)
-      free(s);
+    arena_release(mem, s);
 
     return NULL;
   }
@@ -682,51 +724,52 @@ nfa_stack *new_nfa_stack(int max) {
 }
 
 void free_nfa_stack(nfa_stack *s) {
-  free(s->data);
-  free(s);
+  arena_release(s->mem, s->data);
+  arena_release(s->mem, s);
 }
 
 int nfa_stack_is_full(nfa_stack *s) { return s->top == s->max - 1; }
 int nfa_stack_is_empty(nfa_stack *s) { return s->top == -1; }
 
-nfa nfa_stack_top(nfa_stack *s) { return s->data[s->top]; }
+nfa_fragment nfa_stack_top(nfa_stack *s) { return s->data[s->top]; }
 
-int nfa_stack_push(nfa_stack *s, nfa state) {
+int nfa_stack_push(nfa_stack *s, nfa_fragment fragment) {
   int new_top = ++s->top;
 
   if (new_top > s->max - 1)
     return -1;
 
-  s->data[new_top] = state;
+  s->data[new_top] = fragment;
 
   return 0;
 }
 
-int nfa_stack_pop(nfa_stack *s, nfa *state) {
+int nfa_stack_pop(nfa_stack *s, nfa_fragment *fragment) {
   if (s->top < 0)
     return -1;
 
-  if (state != NULL) {
-    (*state) = s->data[s->top];
+  if (fragment != NULL) {
+    (*fragment) = s->data[s->top];
   }
 
   s->top--;
   return 0;
 }
 
-nfa_state_stack *new_nfa_state_stack(int max) {
-  nfa_state_stack *s = (nfa_state_stack *)malloc(sizeof(nfa_state_stack));
+nfa_state_stack *new_nfa_state_stack(int max, arena *mem) {
+  nfa_state_stack *s =
+      (nfa_state_stack *)arena_alloc(mem, sizeof(nfa_state_stack));
 
   if (s == NULL)
     return NULL;
 
-  s->data = (nfa_state **)malloc(sizeof(nfa_state *) * max);
+  s->data = (int *)arena_alloc(mem, sizeof(int) * max);
+  s->mem = mem;
   s->top = -1;
   s->max = max;
 
   if (s->data == NULL) {
-    if (s != NULL)
-      free(s);
+    arena_release(mem, s);
 
     return NULL;
   }
@@ -735,16 +778,16 @@ nfa_state_stack *new_nfa_state_stack(int max) {
 }
 
 void free_nfa_state_stack(nfa_state_stack *s) {
-  free(s->data);
-  free(s);
+  arena_release(s->mem, s->data);
+  arena_release(s->mem, s);
 }
 
 int nfa_state_stack_is_full(nfa_state_stack *s) { return s->top == s->max - 1; }
 int nfa_state_stack_is_empty(nfa_state_stack *s) { return s->top == -1; }
 
-nfa_state *nfa_state_stack_top(nfa_state_stack *s) { return s->data[s->top]; }
+int nfa_state_stack_top(nfa_state_stack *s) { return s->data[s->top]; }
 
-int nfa_state_stack_push(nfa_state_stack *s, nfa_state *state) {
+int nfa_state_stack_push(nfa_state_stack *s, int state) {
   int new_top = ++s->top;
 
   if (new_top > s->max - 1)
@@ -755,7 +798,7 @@ int nfa_state_stack_push(nfa_state_stack *s, nfa_state *state) {
   return 0;
 }
 
-int nfa_state_stack_pop(nfa_state_stack *s, nfa_state **state) {
+int nfa_state_stack_pop(nfa_state_stack *s, int *state) {
   if (s->top < 0)
     return -1;
 
@@ -767,20 +810,21 @@ int nfa_state_stack_pop(nfa_state_stack *s, nfa_state **state) {
   return 0;
 }
 
-nfa_state_queue *new_nfa_state_queue(int max) {
-  nfa_state_queue *q = (nfa_state_queue *)malloc(sizeof(nfa_state_queue));
+nfa_state_queue *new_nfa_state_queue(int max, arena *mem) {
+  nfa_state_queue *q =
+      (nfa_state_queue *)arena_alloc(mem, sizeof(nfa_state_queue));
 
   if (q == NULL)
     return NULL;
 
-  q->data = (nfa_state **)malloc(sizeof(nfa_state *) * max);
+  q->data = (int *)arena_alloc(mem, sizeof(int) * max);
+  q->mem = mem;
   q->front = -1;
   q->rear = -1;
   q->max = max;
 
   if (q->data == NULL) {
-    if (q != NULL)
-      free(q);
+    arena_release(mem, q);
 
     return NULL;
   }
@@ -789,8 +833,8 @@ nfa_state_queue *new_nfa_state_queue(int max) {
 }
 
 void free_nfa_state_queue(nfa_state_queue *q) {
-  free(q->data);
-  free(q);
+  arena_release(q->mem, q->data);
+  arena_release(q->mem, q);
 }
 
 int nfa_state_queue_is_full(nfa_state_queue *q) {
@@ -799,11 +843,11 @@ int nfa_state_queue_is_full(nfa_state_queue *q) {
 
 int nfa_state_queue_is_empty(nfa_state_queue *q) { return q->front == -1; }
 
-nfa_state *nfa_state_queue_front(nfa_state_queue *q) {
+int nfa_state_queue_front(nfa_state_queue *q) {
   return q->data[q->front];
 }
 
-int nfa_state_queue_enqueue(nfa_state_queue *q, nfa_state *state) {
+int nfa_state_queue_enqueue(nfa_state_queue *q, int state) {
   if ((q->rear + 1) % q->max == q->front)
     return -1;
 
@@ -818,7 +862,7 @@ int nfa_state_queue_enqueue(nfa_state_queue *q, nfa_state *state) {
   return 0;
 }
 
-int nfa_state_queue_dequeue(nfa_state_queue *q, nfa_state **state) {
+int nfa_state_queue_dequeue(nfa_state_queue *q, int *state) {
   if (q->front == -1)
     return -1;
 
@@ -844,3 +888,51 @@ int nfa_state_queue_length(nfa_state_queue *q) {
     return -len;
   return len;
 }
+
+sparse_set *new_sparse_set(int max, arena *mem) {
+  sparse_set *s = (sparse_set *)arena_alloc(mem, sizeof(sparse_set));
+
+  if (s == NULL)
+    return NULL;
+
+  s->dense = (int *)arena_alloc(mem, sizeof(int) * max);
+  s->sparse = (int *)arena_alloc(mem, sizeof(int) * max);
+  s->len = 0;
+  s->max = max;
+  s->mem = mem;
+
+  if (s->dense == NULL || s->sparse == NULL) {
+    arena_release(mem, s->sparse);
+    arena_release(mem, s->dense);
+    arena_release(mem, s);
+    return NULL;
+  }
+
+  // not needed for correctness, but keeps valgrind quiet about lookups of
+  // states that were never added.
+  memset(s->sparse, 0, sizeof(int) * max);
+
+  return s;
+}
+
+void free_sparse_set(sparse_set *s) {
+  arena_release(s->mem, s->sparse);
+  arena_release(s->mem, s->dense);
+  arena_release(s->mem, s);
+}
+
+void sparse_set_clear(sparse_set *s) { s->len = 0; }
+
+int sparse_set_contains(sparse_set *s, int state) {
+  int i = s->sparse[state];
+  return i < s->len && s->dense[i] == state;
+}
+
+int sparse_set_add(sparse_set *s, int state) {
+  if (sparse_set_contains(s, state))
+    return 0;
+
+  s->sparse[state] = s->len;
+  s->dense[s->len++] = state;
+  return 1;
+}
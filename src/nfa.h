@@ -1,83 +1,167 @@
 #ifndef NFA_H_
 #define NFA_H_
 
+#include "arena.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#define NFA_NO_STATE -1
+#define NFA_ALPHABET_SIZE 256
+
+// a state owns at most two transitions. if symbol is '\0' then next is an
+// epsilon transition as well, otherwise next is taken on symbol.
 typedef struct nfa_state {
-  int id;
   char symbol;
-  struct nfa_state *next;
-  struct nfa_state *epsilon;
+  int next;
+  int epsilon;
 } nfa_state;
 
+// the states of an nfa live in one block right after the nfa header, so the
+// whole automaton is freed or copied at once and states refer to each other
+// by index. everything in this file that takes an arena allocates from it,
+// or from the heap when it is NULL, and the free_* functions leave arena
+// memory to the arena.
+//
+// closures[closure_offsets[s]] up to closures[closure_offsets[s + 1]] are the
+// states with a symbol transition, plus the final states, that s reaches
+// through epsilon transitions. they are only filled for init and the targets
+// of symbol transitions, since a simulation is never in any other state, and
+// number_of_closures is how many states that is.
+//
+// bytes that no transition tells apart share a class in byte_classes, so
+// tables built from the nfa only need number_of_classes columns.
+//
+// an nfa built from several regexes has no single final state. pattern_ids
+// is then the index of the regex whose final state s is, or NFA_NO_STATE,
+// and is NULL for an nfa built from one regex.
 typedef struct nfa {
   int number_of_states;
-  nfa_state *init;
-  nfa_state *final;
+  int max_states;
+  int init;
+  int final;
+  int number_of_classes;
+  unsigned char byte_classes[NFA_ALPHABET_SIZE];
+  nfa_state *states;
+  int *closure_offsets;
+  int *closures;
+  int number_of_closures;
+  int *pattern_ids;
+  arena *mem;
 } nfa;
 
+typedef struct nfa_fragment {
+  int init;
+  int final;
+} nfa_fragment;
+
 typedef struct nfa_stack {
   int top;
   int max;
-  nfa *data;
+  nfa_fragment *data;
+  arena *mem;
 } nfa_stack;
 
 typedef struct nfa_state_stack {
   int top;
   int max;
-  nfa_state **data;
+  int *data;
+  arena *mem;
 } nfa_state_stack;
 
 typedef struct nfa_state_queue {
   int rear;
   int front;
   int max;
-  nfa_state **data;
+  int *data;
+  arena *mem;
 } nfa_state_queue;
 
-void free_nfa_state(nfa_state *s, int *visited, int visited_len);
+// a set of states with constant time insert, lookup and clear. dense keeps
+// the insertion order, which is the order the simulation visits states in.
+typedef struct sparse_set {
+  int len;
+  int max;
+  int *dense;
+  int *sparse;
+  arena *mem;
+} sparse_set;
+
+// what a simulation of an nfa works in, sized from it once, so every
+// simulation that reuses it runs without allocating. the starts are the
+// leftmost start of the thread in every state, which only a search needs.
+typedef struct nfa_scratch {
+  sparse_set *curr;
+  sparse_set *next;
+  int *curr_starts;
+  int *next_starts;
+  arena *mem;
+} nfa_scratch;
+
 void free_nfa(nfa *n);
 void free_nfa_stack(nfa_stack *s);
 void free_nfa_state_stack(nfa_state_stack *s);
 void free_nfa_state_queue(nfa_state_queue *q);
+void free_sparse_set(sparse_set *s);
+void free_nfa_scratch(nfa_scratch *s);
 
-nfa_stack *new_nfa_stack(int max);
+nfa_stack *new_nfa_stack(int max, arena *mem);
 int nfa_stack_is_full(nfa_stack *s);
 int nfa_stack_is_empty(nfa_stack *s);
-nfa nfa_stack_top(nfa_stack *s);
-int nfa_stack_push(nfa_stack *s, nfa state);
-int nfa_stack_pop(nfa_stack *s, nfa *state);
+nfa_fragment nfa_stack_top(nfa_stack *s);
+int nfa_stack_push(nfa_stack *s, nfa_fragment fragment);
+int nfa_stack_pop(nfa_stack *s, nfa_fragment *fragment);
 
-nfa_state_stack *new_nfa_state_stack(int max);
+nfa_state_stack *new_nfa_state_stack(int max, arena *mem);
 int nfa_state_stack_is_full(nfa_state_stack *s);
 int nfa_state_stack_is_empty(nfa_state_stack *s);
-nfa_state *nfa_state_stack_top(nfa_state_stack *s);
-int nfa_state_stack_push(nfa_state_stack *s, nfa_state *state);
-int nfa_state_stack_pop(nfa_state_stack *s, nfa_state **state);
+int nfa_state_stack_top(nfa_state_stack *s);
+int nfa_state_stack_push(nfa_state_stack *s, int state);
+int nfa_state_stack_pop(nfa_state_stack *s, int *state);
 
-nfa_state_queue *new_nfa_state_queue(int max);
+nfa_state_queue *new_nfa_state_queue(int max, arena *mem);
 int nfa_state_queue_is_full(nfa_state_queue *q);
 int nfa_state_queue_is_empty(nfa_state_queue *q);
-nfa_state *nfa_state_queue_front(nfa_state_queue *q);
-int nfa_state_queue_enqueue(nfa_state_queue *q, nfa_state *state);
-int nfa_state_queue_dequeue(nfa_state_queue *q, nfa_state **state);
+int nfa_state_queue_front(nfa_state_queue *q);
+int nfa_state_queue_enqueue(nfa_state_queue *q, int state);
+int nfa_state_queue_dequeue(nfa_state_queue *q, int *state);
 int nfa_state_queue_length(nfa_state_queue *q);
 
-nfa_state *new_nfa_state(int id);
-int add_nfa_transition(nfa_state *from, nfa_state *to, char symbol);
-int add_epsilon_nfa_transition(nfa_state *from, nfa_state *to);
+sparse_set *new_sparse_set(int max, arena *mem);
+void sparse_set_clear(sparse_set *s);
+int sparse_set_contains(sparse_set *s, int state);
+int sparse_set_add(sparse_set *s, int state);
+
+nfa_scratch *new_nfa_scratch(const nfa *n, arena *mem);
+
+int is_nfa_symbol(char c);
+int is_nfa_final(const nfa *n, int s);
+
+nfa *new_nfa(int max_states, arena *mem);
+nfa *copy_nfa(const nfa *n, arena *mem);
+int new_nfa_state(nfa *n);
+int add_nfa_transition(nfa *n, int from, int to, char symbol);
+int add_epsilon_nfa_transition(nfa *n, int from, int to);
 
-int append_to_closures(nfa_state *closure_state, nfa_state ***closures,
-                       int *len, int *max);
-nfa_state **get_epsilon_transitions(nfa_state *s, int *transitions_len);
-nfa_state **find_epsilon_closures(nfa *n, nfa_state *s, int *closures_len);
-nfa_state **find_epsilon_closures_without_final_states(nfa *n, nfa_state *s,
-                                                       int *closures_len);
-nfa *new_nfa_from_regex(const char *regex, int len);
-int evaluate_string_in_nfa(nfa *n, const char *str, int str_len);
+int get_epsilon_transitions(nfa *n, int s, int *transitions);
+int find_all_epsilon_closures(nfa *n, arena *mem);
+void find_byte_classes(nfa *n);
+const int *get_epsilon_closures(nfa *n, int s, int *closures_len);
+void add_nfa_state_to_set(nfa *n, sparse_set *set, int s);
+void step_nfa_set(nfa *n, sparse_set *curr, sparse_set *next, char c);
+nfa *new_nfa_from_regex(const char *regex, int len, arena *mem);
+nfa *new_reverse_nfa_from_regex(const char *regex, int len, arena *mem);
+nfa *new_nfa_from_regexes(const char **regexes, const int *lens, int count,
+                          arena *mem);
+int evaluate_string_in_nfa(nfa *n, const char *str, int str_len, arena *mem);
+int search_string_in_nfa(nfa *n, const char *str, int str_len, int max_start,
+                         int *start, int *end, arena *mem);
+int evaluate_string_in_nfa_with(nfa *n, nfa_scratch *scratch,
+                                const char *str, int str_len);
+int search_string_in_nfa_with(nfa *n, nfa_scratch *scratch, const char *str,
+                              int str_len, int max_start, int *start,
+                              int *end);
 
-void print_nfa_state(nfa_state *state, int *visited);
 void print_nfa(nfa *nfa);
 
 #endif
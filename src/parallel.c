@@ -0,0 +1,362 @@
+#include "parallel.h"
+#include <limits.h>
+#include <unistd.h>
+
+// every lane that is in the same state as an earlier one is folded into it.
+// a reverse chunk first keeps the hits the lanes had so far for the states
+// they started from, since the merged lane only records the hits after it.
+static void merge_lanes(parallel_chunk *c, int *lanes_len) {
+  int states_len = c->d->number_of_states;
+  int merged = 0;
+
+  if (c->reverse) {
+    for (int s = 0; s < states_len; s++) {
+      if (c->lane_of[s] != -1 && c->lane_hits[c->lane_of[s]] != PARALLEL_NO_HIT)
+        c->hits[s] = c->lane_hits[c->lane_of[s]];
+    }
+  }
+
+  for (int j = 0; j < *lanes_len; j++) {
+    int q = c->lanes[j];
+
+    if (c->seen[q] == -1) {
+      c->seen[q] = merged;
+      c->lanes[merged] = q;
+      c->lane_hits[merged] = PARALLEL_NO_HIT;
+      merged++;
+    }
+
+    c->renumber[j] = c->seen[q];
+  }
+
+  for (int j = 0; j < merged; j++)
+    c->seen[c->lanes[j]] = -1;
+
+  for (int s = 0; s < states_len; s++) {
+    if (c->lane_of[s] != -1)
+      c->lane_of[s] = c->renumber[c->lane_of[s]];
+  }
+
+  *lanes_len = merged;
+}
+
+static void *run_parallel_chunk(void *arg) {
+  parallel_chunk *c = (parallel_chunk *)arg;
+  dfa *d = c->d;
+  int states_len = d->number_of_states;
+  int classes_len = d->number_of_classes;
+  int lanes_len = 0;
+
+  for (int s = 0; s < states_len; s++) {
+    c->hits[s] = PARALLEL_NO_HIT;
+    c->seen[s] = -1;
+    c->lane_of[s] = -1;
+
+    if (c->start == -1 || c->start == s) {
+      c->lane_of[s] = lanes_len;
+      c->lanes[lanes_len] = s;
+      c->lane_hits[lanes_len] = PARALLEL_NO_HIT;
+      lanes_len++;
+    }
+  }
+
+  // merging walks every state, so it runs once per that many bytes at most.
+  size_t merge_every = states_len > 64 ? states_len : 64;
+  size_t len = c->to - c->from;
+  size_t done = 0;
+
+  while (done < len && lanes_len > 0) {
+    size_t step = len - done < merge_every ? len - done : merge_every;
+
+    if (c->reverse) {
+      for (size_t i = 0; i < step; i++) {
+        size_t pos = c->to - 1 - done - i;
+        unsigned char k = d->byte_classes[(unsigned char)c->str[pos]];
+
+        for (int j = 0; j < lanes_len; j++) {
+          int t = d->transitions[(size_t)c->lanes[j] * classes_len + k];
+          c->lanes[j] = t;
+
+          if (d->accepting[t])
+            c->lane_hits[j] = pos;
+        }
+      }
+    } else {
+      for (size_t i = 0; i < step; i++) {
+        unsigned char k =
+            d->byte_classes[(unsigned char)c->str[c->from + done + i]];
+
+        for (int j = 0; j < lanes_len; j++)
+          c->lanes[j] = d->transitions[(size_t)c->lanes[j] * classes_len + k];
+      }
+    }
+
+    done += step;
+
+    if (lanes_len > 1)
+      merge_lanes(c, &lanes_len);
+
+    // the dead state never leaves itself, so the rest of the chunk can not
+    // change a map that only leads there.
+    if (lanes_len == 1 && c->lanes[0] == d->dead)
+      break;
+  }
+
+  for (int s = 0; s < states_len; s++) {
+    if (c->lane_of[s] == -1) {
+      c->map[s] = d->dead;
+      continue;
+    }
+
+    c->map[s] = c->lanes[c->lane_of[s]];
+
+    if (c->reverse && c->lane_hits[c->lane_of[s]] != PARALLEL_NO_HIT)
+      c->hits[s] = c->lane_hits[c->lane_of[s]];
+  }
+
+  return NULL;
+}
+
+// splits str into chunks, reads them on up to that many threads, and leaves
+// the chunks in the arena it returns. the first chunk read forwards, or the
+// last one read backwards, begins in the initial state and is only read from
+// it.
+static arena *run_parallel_chunks(dfa *d, const char *str, size_t str_len,
+                                  int reverse, int chunks_len,
+                                  parallel_chunk *chunks) {
+  size_t states_len = d->number_of_states;
+  size_t per_chunk = sizeof(int) * 6 * states_len +
+                     sizeof(size_t) * 2 * states_len + ARENA_ALIGNMENT * 8;
+  arena *mem = new_arena(per_chunk * chunks_len);
+
+  if (mem == NULL)
+    return NULL;
+
+  size_t chunk_len = str_len / chunks_len;
+
+  for (int i = 0; i < chunks_len; i++) {
+    parallel_chunk *c = &chunks[i];
+
+    c->d = d;
+    c->str = str;
+    c->from = chunk_len * i;
+    c->to = i == chunks_len - 1 ? str_len : chunk_len * (i + 1);
+    c->reverse = reverse;
+    c->start = -1;
+    c->map = (int *)arena_alloc(mem, sizeof(int) * states_len);
+    c->hits = (size_t *)arena_alloc(mem, sizeof(size_t) * states_len);
+    c->lanes = (int *)arena_alloc(mem, sizeof(int) * states_len);
+    c->lane_of = (int *)arena_alloc(mem, sizeof(int) * states_len);
+    c->renumber = (int *)arena_alloc(mem, sizeof(int) * states_len);
+    c->seen = (int *)arena_alloc(mem, sizeof(int) * states_len);
+    c->lane_hits = (size_t *)arena_alloc(mem, sizeof(size_t) * states_len);
+
+    if (c->map == NULL || c->hits == NULL || c->lanes == NULL ||
+        c->lane_of == NULL || c->renumber == NULL || c->seen == NULL ||
+        c->lane_hits == NULL) {
+      free_arena(mem);
+      return NULL;
+    }
+  }
+
+  chunks[reverse ? chunks_len - 1 : 0].start = d->init;
+
+  // the calling thread reads the first chunk, and any chunk whose thread
+  // could not be started.
+  int started[PARALLEL_MAX_THREADS];
+
+  for (int i = 1; i < chunks_len; i++) {
+    started[i] = pthread_create(&chunks[i].thread, NULL, run_parallel_chunk,
+                                &chunks[i]) == 0;
+  }
+
+  run_parallel_chunk(&chunks[0]);
+
+  for (int i = 1; i < chunks_len; i++) {
+    if (started[i])
+      pthread_join(chunks[i].thread, NULL);
+    else
+      run_parallel_chunk(&chunks[i]);
+  }
+
+  return mem;
+}
+
+static int count_parallel_chunks(size_t str_len, int threads) {
+  if (threads <= 0)
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (threads > PARALLEL_MAX_THREADS)
+    threads = PARALLEL_MAX_THREADS;
+
+  if ((size_t)threads > str_len / PARALLEL_MIN_CHUNK)
+    threads = str_len / PARALLEL_MIN_CHUNK;
+
+  return threads < 1 ? 1 : threads;
+}
+
+// threads calling at once may each build the dfa, but only the first one
+// put in *at is kept, and the others free theirs and use it.
+static dfa *publish_dfa(dfa **at, dfa *d) {
+  dfa *expected = NULL;
+
+  if (d == NULL)
+    return NULL;
+
+  if (__atomic_compare_exchange_n(at, &expected, d, 0, __ATOMIC_ACQ_REL,
+                                  __ATOMIC_ACQUIRE))
+    return d;
+
+  free_dfa(d);
+  return expected;
+}
+
+// the full dfa of the regex if it has one, otherwise a minimized one built
+// on the first call. NULL when the pattern needs too many states for one.
+static dfa *get_forward_dfa(const regex *r) {
+  if (r->full != NULL)
+    return r->full;
+
+  dfa *forward = __atomic_load_n(&r->runtime->forward, __ATOMIC_ACQUIRE);
+
+  if (forward == NULL) {
+    int err;
+    dfa *d = new_dfa_from_nfa(r->n, r->dfa_state_limit, 0, &err);
+
+    if (d == NULL)
+      return NULL;
+
+    forward = publish_dfa(&r->runtime->forward, minimize_dfa(d));
+    free_dfa(d);
+  }
+
+  return forward;
+}
+
+// the unanchored dfa of the reversed pattern, which reading str backwards
+// is accepting right after every offset a match starts at.
+static dfa *get_reverse_dfa(const regex *r) {
+  dfa *reverse = __atomic_load_n(&r->runtime->reverse, __ATOMIC_ACQUIRE);
+
+  if (reverse == NULL) {
+    nfa *n = new_reverse_nfa_from_regex(r->postfix, strlen(r->postfix), NULL);
+
+    if (n == NULL)
+      return NULL;
+
+    int err;
+    dfa *d = new_dfa_from_nfa(n, r->dfa_state_limit, 1, &err);
+    free_nfa(n);
+
+    if (d == NULL)
+      return NULL;
+
+    reverse = publish_dfa(&r->runtime->reverse, minimize_dfa(d));
+    free_dfa(d);
+  }
+
+  return reverse;
+}
+
+int regex_match_parallel(const regex *r, const char *str, size_t str_len,
+                         int threads) {
+  if (r == NULL || (str == NULL && str_len > 0))
+    return -1;
+
+  int chunks_len = count_parallel_chunks(str_len, threads);
+  dfa *d = chunks_len > 1 ? get_forward_dfa(r) : NULL;
+
+  // without a dfa to split the input for, the regex matches it as usual.
+  if (d == NULL)
+    return str_len > INT_MAX ? -1 : regex_match(r, str, str_len);
+
+  parallel_chunk chunks[PARALLEL_MAX_THREADS];
+  arena *mem = run_parallel_chunks(d, str, str_len, 0, chunks_len, chunks);
+
+  if (mem == NULL)
+    return -1;
+
+  int s = d->init;
+
+  for (int i = 0; i < chunks_len; i++)
+    s = chunks[i].map[s];
+
+  free_arena(mem);
+
+  return d->accepting[s];
+}
+
+// the reverse dfa finds the leftmost offset a match starts at, and the
+// forward dfa then reads on from there for the longest match. only the
+// reverse pass runs in parallel, the forward one stops at the dead state.
+int regex_search_parallel(const regex *r, const char *str, size_t str_len,
+                          int threads, size_t *start, size_t *end) {
+  if (r == NULL || (str == NULL && str_len > 0) || start == NULL ||
+      end == NULL)
+    return -1;
+
+  int chunks_len = count_parallel_chunks(str_len, threads);
+  dfa *reverse = chunks_len > 1 ? get_reverse_dfa(r) : NULL;
+  dfa *forward = reverse != NULL ? get_forward_dfa(r) : NULL;
+
+  if (forward == NULL) {
+    if (str_len > INT_MAX)
+      return -1;
+
+    int found_start;
+    int found_end;
+    int found = regex_search(r, str, str_len, &found_start, &found_end);
+
+    if (found == 1) {
+      *start = found_start;
+      *end = found_end;
+    }
+
+    return found;
+  }
+
+  parallel_chunk chunks[PARALLEL_MAX_THREADS];
+  arena *mem =
+      run_parallel_chunks(reverse, str, str_len, 1, chunks_len, chunks);
+
+  if (mem == NULL)
+    return -1;
+
+  // the states the reverse dfa begins each chunk in, from the last chunk
+  // back, after which the leftmost chunk with a hit holds the match start.
+  int entries[PARALLEL_MAX_THREADS];
+  int s = reverse->init;
+
+  for (int i = chunks_len - 1; i >= 0; i--) {
+    entries[i] = s;
+    s = chunks[i].map[s];
+  }
+
+  size_t from = reverse->accepting[reverse->init] ? str_len : PARALLEL_NO_HIT;
+
+  for (int i = 0; i < chunks_len; i++) {
+    if (chunks[i].hits[entries[i]] != PARALLEL_NO_HIT) {
+      from = chunks[i].hits[entries[i]];
+      break;
+    }
+  }
+
+  free_arena(mem);
+
+  if (from == PARALLEL_NO_HIT)
+    return 0;
+
+  s = forward->init;
+  *start = from;
+  *end = from;
+
+  for (size_t i = from; i < str_len && s != forward->dead; i++) {
+    unsigned char k = forward->byte_classes[(unsigned char)str[i]];
+    s = forward->transitions[(size_t)s * forward->number_of_classes + k];
+
+    if (forward->accepting[s])
+      *end = i + 1;
+  }
+
+  return 1;
+}
@@ -0,0 +1,56 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include "arena.h"
+#include "dfa.h"
+#include "regex.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// inputs shorter than PARALLEL_MIN_CHUNK per thread are matched on the
+// calling thread, since a chunk costs a pass from every dfa state at first.
+#define PARALLEL_MIN_CHUNK (1 << 16)
+#define PARALLEL_MAX_THREADS 256
+#define PARALLEL_NO_HIT ((size_t)-1)
+
+// a chunk of the input and the map from every dfa state to the state the dfa
+// is in after reading the chunk from it, backwards for a reverse chunk. start
+// is the only state the chunk is read from when the state it begins in is
+// already known, otherwise -1. hits holds, for every state of a reverse
+// chunk, the lowest offset at which the dfa reading from it was accepting.
+//
+// the states are read in lanes, and lanes that reach the same state are
+// merged, since they can not part again. most dfas collapse to a few lanes
+// after a short stretch of input, so a chunk costs little more than one pass.
+typedef struct parallel_chunk {
+  dfa *d;
+  const char *str;
+  size_t from;
+  size_t to;
+  int reverse;
+  int start;
+  int *map;
+  size_t *hits;
+  int *lanes;
+  int *lane_of;
+  int *renumber;
+  int *seen;
+  size_t *lane_hits;
+  pthread_t thread;
+} parallel_chunk;
+
+// regex_match_parallel splits the whole match over the threads.
+// regex_search_parallel only splits the reverse pass that finds where the
+// leftmost match starts. the forward pass for its end runs on the calling
+// thread, since it stops at the dead state, which for most patterns comes
+// soon after the match, while chunks would read all the rest of the input.
+// a search whose match runs on to the end of a long input therefore takes
+// about as long as regex_search.
+int regex_match_parallel(const regex *r, const char *str, size_t str_len,
+                         int threads);
+int regex_search_parallel(const regex *r, const char *str, size_t str_len,
+                          int threads, size_t *start, size_t *end);
+
+#endif
@@ -1,61 +1,811 @@
 #include "regex.h"
+#include "cache.h"
 
-int evaluate_string(const char *str, const char *regex, int show_log) {
-  if (str == NULL) {
-    printf("The provided string is empty!");
+regex *regex_compile(const char *pattern) {
+  return regex_compile_with_options(pattern, NULL, NULL);
+}
+
+static int context_heap_allocations(const regex_match_context *c) {
+  int heap_allocations = c->mem->heap_allocations;
+
+  if (c->lazy != NULL)
+    heap_allocations += c->lazy->mem->heap_allocations;
+
+  if (c->search != NULL)
+    heap_allocations += c->search->mem->heap_allocations;
+
+  return heap_allocations;
+}
+
+static size_t context_bytes_reserved(const regex_match_context *c) {
+  size_t bytes_reserved = c->mem->bytes_reserved;
+
+  if (c->lazy != NULL)
+    bytes_reserved += c->lazy->mem->bytes_reserved;
+
+  if (c->search != NULL)
+    bytes_reserved += c->search->mem->bytes_reserved;
+
+  return bytes_reserved;
+}
+
+#ifdef REGEX_STATS
+// the time since *phase, which then starts the next phase.
+static uint64_t next_phase(uint64_t *phase) {
+  uint64_t now = regex_stats_now_ns();
+  uint64_t elapsed = now - *phase;
+
+  *phase = now;
+  return elapsed;
+}
+#endif
+
+static regex *fail_compile(regex *r, int *err, int code) {
+  regex_free(r);
+
+  if (err != NULL)
+    *err = code;
+
+  return NULL;
+}
+
+regex *regex_compile_with_options(const char *pattern,
+                                  const regex_options *options, int *err) {
+  if (pattern == NULL)
+    return fail_compile(NULL, err, REGEX_ERR_SYNTAX);
+
+  size_t dfa_cache_size = REGEX_DEFAULT_DFA_CACHE_SIZE;
+  int dfa_state_limit = REGEX_DEFAULT_DFA_STATE_LIMIT;
+  int full_dfa = 0;
+  int bit_parallel = 1;
+
+  if (options != NULL) {
+    if (options->dfa_cache_size > 0)
+      dfa_cache_size = options->dfa_cache_size;
+
+    if (options->dfa_state_limit > 0)
+      dfa_state_limit = options->dfa_state_limit;
+
+    full_dfa = options->full_dfa;
+    bit_parallel = !options->no_bit_parallel;
+  }
+
+  int pattern_len = strlen(pattern);
+  int standard_len;
+
+  // one block is enough for the pattern copies, the construction stacks and
+  // the nfa itself, which all grow linearly with the pattern.
+  arena *mem = new_arena(pattern_len * 96 + 1024);
+
+  if (mem == NULL)
+    return fail_compile(NULL, err, REGEX_ERR_NO_MEMORY);
+
+  regex *r = (regex *)arena_alloc(mem, sizeof(regex));
+
+  if (r == NULL) {
+    free_arena(mem);
+    return fail_compile(NULL, err, REGEX_ERR_NO_MEMORY);
+  }
+
+  r->mem = mem;
+  r->full = NULL;
+  r->bits = NULL;
+  r->alternates = NULL;
+  r->dfa_cache_size = dfa_cache_size;
+  r->dfa_state_limit = dfa_state_limit;
+  r->standard = NULL;
+  r->postfix = NULL;
+  r->n = NULL;
+  r->pattern = NULL;
+  r->runtime = (regex_runtime *)arena_alloc(mem, sizeof(regex_runtime));
+
+  if (r->runtime != NULL) {
+    memset(r->runtime, 0, sizeof(regex_runtime));
+    r->pattern = (char *)arena_alloc(mem, sizeof(char) * (pattern_len + 1));
+  }
+
+  if (r->pattern == NULL)
+    return fail_compile(r, err, REGEX_ERR_NO_MEMORY);
+
+  memcpy(r->pattern, pattern, pattern_len + 1);
+
+  REGEX_STATS_ONLY(uint64_t phase = regex_stats_now_ns();)
+
+  r->standard = standardize_regex(pattern, pattern_len, &standard_len, mem);
+
+  if (r->standard == NULL)
+    return fail_compile(r, err, REGEX_ERR_NO_MEMORY);
+
+  REGEX_STATS_ONLY(r->runtime->counters.standardize_ns = next_phase(&phase);)
+
+  r->postfix = regex_to_postfix(r->standard, standard_len, mem);
+
+  if (r->postfix == NULL)
+    return fail_compile(r, err, REGEX_ERR_SYNTAX);
+
+  REGEX_STATS_ONLY(r->runtime->counters.postfix_ns = next_phase(&phase);)
+
+  r->n = new_nfa_from_regex(r->postfix, strlen(r->postfix), mem);
+
+  if (r->n == NULL)
+    return fail_compile(r, err, REGEX_ERR_SYNTAX);
+
+  REGEX_STATS_ONLY(r->runtime->counters.nfa_ns = next_phase(&phase);)
+
+  if (find_regex_literals(r->postfix, strlen(r->postfix), &r->literals,
+                          mem) == -1)
+    return fail_compile(r, err, REGEX_ERR_NO_MEMORY);
+
+  if (r->literals.scan_alternates) {
+    const char *alternates[LITERAL_MAX_ALTERNATES];
+
+    for (int i = 0; i < r->literals.alternates_len; i++)
+      alternates[i] = r->literals.alternates[i];
+
+    r->alternates = new_teddy(alternates, r->literals.alternate_lens,
+                              r->literals.alternates_len, mem);
+
+    if (r->alternates == NULL)
+      return fail_compile(r, err, REGEX_ERR_NO_MEMORY);
+  }
+
+  // a pattern whose positions do not fit one word gets no glushkov
+  // automaton, and since the other engines can always match it, neither
+  // does one that ran out of memory building it.
+  int postfix_len = strlen(r->postfix);
+
+  if (bit_parallel && !full_dfa &&
+      count_glushkov_positions(r->postfix, postfix_len) <=
+          GLUSHKOV_DEFAULT_POSITIONS)
+    r->bits = new_glushkov_from_regex(r->postfix, postfix_len, mem);
+
+  size_t dfa_heap_allocations = 0;
+  size_t dfa_bytes_reserved = 0;
+
+  if (full_dfa) {
+    int dfa_err;
+    dfa *d = new_dfa_from_nfa(r->n, dfa_state_limit, 0, &dfa_err);
+
+    if (d == NULL) {
+      return fail_compile(r, err,
+                          dfa_err == DFA_TOO_MANY_STATES
+                              ? REGEX_ERR_TOO_MANY_STATES
+                              : REGEX_ERR_NO_MEMORY);
+    }
+
+    r->full = minimize_dfa(d);
+    free_dfa(d);
+
+    if (r->full == NULL)
+      return fail_compile(r, err, REGEX_ERR_NO_MEMORY);
+
+    dfa_heap_allocations = r->full->mem->heap_allocations;
+    dfa_bytes_reserved = r->full->mem->bytes_reserved;
+  }
+
+  // the first context is made last, since whether it needs a lazy dfa
+  // depends on the engines above, and is pooled right away, so a regex only
+  // used from one thread never makes another.
+  regex_match_context *c = regex_borrow_context(r);
+
+  if (c == NULL)
+    return fail_compile(r, err, REGEX_ERR_NO_MEMORY);
+
+  r->stats.compile_heap_allocations =
+      mem->heap_allocations + context_heap_allocations(c) +
+      dfa_heap_allocations;
+  r->stats.compile_bytes_reserved =
+      mem->bytes_reserved + context_bytes_reserved(c) + dfa_bytes_reserved;
+  r->stats.match_heap_allocations = 0;
+  r->stats.match_bytes_reserved = 0;
+
+  // the epsilon closures of the nfa's entry states are computed once, up
+  // front.
+  REGEX_STATS_ONLY({
+    r->runtime->counters.dfa_ns = next_phase(&phase);
+    r->runtime->counters.states = r->n->number_of_states;
+    r->runtime->counters.closures = r->n->number_of_closures;
+    r->runtime->counters.heap_allocations = r->stats.compile_heap_allocations;
+
+    if (r->full != NULL)
+      r->runtime->counters.states += r->full->number_of_states;
+  })
+
+  // the context's lazy dfa counted the states it starts with, which are
+  // added to the counters set above.
+  regex_return_context(r, c);
+
+  if (err != NULL)
+    *err = REGEX_OK;
+
+  return r;
+}
+
+regex_match_context *new_regex_match_context(const regex *r) {
+  if (r == NULL)
+    return NULL;
+
+  // the two sets, the stack and the two start arrays of the nfa simulation,
+  // and room to align every allocation.
+  arena *mem = new_arena(sizeof(regex_match_context) + sizeof(nfa_scratch) +
+                         sizeof(int) * r->n->number_of_states * 7 +
+                         ARENA_ALIGNMENT * 16);
+
+  if (mem == NULL)
+    return NULL;
+
+  regex_match_context *c =
+      (regex_match_context *)arena_alloc(mem, sizeof(regex_match_context));
+
+  if (c == NULL) {
+    free_arena(mem);
+    return NULL;
+  }
+
+  c->r = r;
+  c->slot = -1;
+  c->lazy = NULL;
+  c->search = NULL;
+  c->mem = mem;
+  c->nfa = new_nfa_scratch(r->n, mem);
+
+  if (c->nfa == NULL) {
+    free_arena(mem);
+    return NULL;
+  }
+
+  if (r->full == NULL && r->bits == NULL) {
+    c->lazy = new_lazy_dfa(r->n, r->dfa_cache_size, 0);
+
+    if (c->lazy == NULL) {
+      free_arena(mem);
+      return NULL;
+    }
+  }
+
+  return c;
+}
+
+void free_regex_match_context(regex_match_context *c) {
+  if (c == NULL)
+    return;
+
+  free_lazy_dfa(c->lazy);
+  free_lazy_dfa(c->search);
+  free_arena(c->mem);
+}
+
+#define POOL_TOP(head) ((int)((head)&0xffffffffu) - 1)
+#define POOL_HEAD(head, top)                                                   \
+  ((((head) >> 32) + 1) << 32 | (uint32_t)((top) + 1))
+
+// the context on top of the stack, or NULL when every one is in use.
+void *regex_pool_pop(regex_pool *p) {
+  uint64_t head = __atomic_load_n(&p->free_head, __ATOMIC_ACQUIRE);
+
+  while (POOL_TOP(head) != -1) {
+    int top = POOL_TOP(head);
+    int next = __atomic_load_n(&p->next[top], __ATOMIC_RELAXED);
+
+    if (__atomic_compare_exchange_n(&p->free_head, &head,
+                                    POOL_HEAD(head, next), 1, __ATOMIC_ACQUIRE,
+                                    __ATOMIC_ACQUIRE))
+      return p->contexts[top];
+  }
+
+  return NULL;
+}
+
+// gives c, which its caller is using, a slot of its own, or returns -1 when
+// the pool has no slots left.
+int regex_pool_add(regex_pool *p, void *c) {
+  int slot = __atomic_load_n(&p->slots_used, __ATOMIC_RELAXED);
+
+  while (slot < REGEX_MAX_POOLED_CONTEXTS) {
+    if (__atomic_compare_exchange_n(&p->slots_used, &slot, slot + 1, 1,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      __atomic_store_n(&p->contexts[slot], c, __ATOMIC_RELEASE);
+      return slot;
+    }
+  }
+
+  return -1;
+}
+
+void regex_pool_push(regex_pool *p, int slot) {
+  uint64_t head = __atomic_load_n(&p->free_head, __ATOMIC_RELAXED);
+
+  do {
+    __atomic_store_n(&p->next[slot], POOL_TOP(head), __ATOMIC_RELAXED);
+  } while (!__atomic_compare_exchange_n(&p->free_head, &head,
+                                        POOL_HEAD(head, slot), 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+regex_match_context *regex_borrow_context(const regex *r) {
+  regex_match_context *c =
+      (regex_match_context *)regex_pool_pop(&r->runtime->pool);
+
+  if (c != NULL)
+    return c;
+
+  // every pooled context is in use, so a new one is made, and kept in the
+  // pool while it has slots left.
+  c = new_regex_match_context(r);
+
+  if (c != NULL)
+    c->slot = regex_pool_add(&r->runtime->pool, c);
+
+  return c;
+}
+
+#ifdef REGEX_STATS
+static void add_lazy_dfa_stats(regex_stats *to, lazy_dfa *d) {
+  if (d == NULL)
+    return;
+
+  regex_stats *from = &d->stats;
+  int high_water = __atomic_load_n(&to->queue_high_water, __ATOMIC_RELAXED);
+
+  __atomic_fetch_add(&to->states, from->states, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&to->closures, from->closures, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&to->dfa_cache_hits, from->dfa_cache_hits,
+                     __ATOMIC_RELAXED);
+  __atomic_fetch_add(&to->dfa_cache_misses, from->dfa_cache_misses,
+                     __ATOMIC_RELAXED);
+
+  while (from->queue_high_water > high_water &&
+         !__atomic_compare_exchange_n(&to->queue_high_water, &high_water,
+                                      from->queue_high_water, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+
+  memset(from, 0, sizeof(regex_stats));
+}
+#endif
+
+// what the lazy dfas of c counted is added to the regex's counters while
+// the caller still holds c, so regex_get_stats never reads a lazy dfa that
+// another thread is matching with.
+void regex_return_context(const regex *r, regex_match_context *c) {
+  if (c == NULL)
+    return;
+
+  REGEX_STATS_ONLY({
+    add_lazy_dfa_stats(&r->runtime->counters, c->lazy);
+    add_lazy_dfa_stats(&r->runtime->counters, c->search);
+  })
+
+  if (c->slot == -1)
+    free_regex_match_context(c);
+  else
+    regex_pool_push(&r->runtime->pool, c->slot);
+}
+
+// the heap traffic of the context a match or search of r went through. the
+// stores only keep the numbers of some last call when threads race on them.
+static void record_match(const regex *r, const regex_match_context *c,
+                         int heap_allocations) {
+  regex_runtime *rt = r->runtime;
+  int allocations = context_heap_allocations(c) - heap_allocations;
+
+  __atomic_store_n(&rt->match_heap_allocations, allocations,
+                   __ATOMIC_RELAXED);
+  __atomic_store_n(&rt->match_bytes_reserved, context_bytes_reserved(c),
+                   __ATOMIC_RELAXED);
+
+  REGEX_STATS_ONLY({
+    __atomic_fetch_add(&rt->counters.matches, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&rt->counters.heap_allocations, allocations,
+                       __ATOMIC_RELAXED);
+  })
+}
+
+int regex_match_with(regex_match_context *c, const char *str, int str_len) {
+  const regex *r = c->r;
+
+  if (!literals_may_match(&r->literals, str, str_len))
+    return 0;
+
+  if (r->alternates != NULL &&
+      teddy_find(r->alternates, str, str_len, NULL) == -1)
+    return 0;
+
+  if (r->full != NULL)
+    return dfa_match(r->full, str, str_len);
+
+  if (r->bits != NULL)
+    return glushkov_match(r->bits, str, str_len);
+
+  int evaluated = lazy_dfa_match(c->lazy, str, str_len);
+
+  if (evaluated == LAZY_DFA_GAVE_UP)
+    evaluated = evaluate_string_in_nfa_with(r->n, c->nfa, str, str_len);
+
+  return evaluated;
+}
+
+int regex_match(const regex *r, const char *str, int str_len) {
+  if (r == NULL || str == NULL)
     return -1;
+
+  regex_match_context *c = regex_borrow_context(r);
+
+  if (c == NULL)
+    return -1;
+
+  REGEX_STATS_ONLY(uint64_t started = regex_stats_now_ns();)
+
+  int heap_allocations = context_heap_allocations(c);
+  int evaluated = regex_match_with(c, str, str_len);
+
+  REGEX_STATS_ONLY(__atomic_fetch_add(&r->runtime->counters.match_ns,
+                                      regex_stats_now_ns() - started,
+                                      __ATOMIC_RELAXED);)
+
+  record_match(r, c, heap_allocations);
+  regex_return_context(r, c);
+
+  return evaluated;
+}
+
+int regex_search_with(regex_match_context *c, const char *str, int str_len,
+                      int *start, int *end) {
+  const regex *r = c->r;
+  int skipped = find_literal_candidate(&r->literals, str, str_len);
+
+  if (skipped == -1)
+    return 0;
+
+  if (r->alternates != NULL &&
+      teddy_find(r->alternates, str + skipped, str_len - skipped, NULL) == -1)
+    return 0;
+
+  if (r->literals.exact) {
+    *start = skipped;
+    *end = skipped + r->literals.prefix_len;
+    return 1;
   }
 
-  if (regex == NULL) {
-    printf("The provided regex is empty!");
+  str += skipped;
+  str_len -= skipped;
+
+  // the unanchored dfa is only built once a context is searched with.
+  if (c->search == NULL) {
+    c->search = new_lazy_dfa(r->n, r->dfa_cache_size, 1);
+
+    if (c->search == NULL)
+      return -1;
+  }
+
+  int max_start = str_len;
+  int found = lazy_dfa_find(c->search, str, str_len, &max_start);
+
+  if (found == -1 || found == 0)
+    return found;
+
+  // a match ends where the dfa first accepts, so the leftmost match starts
+  // there at the latest, and the nfa only has to start threads up to it to
+  // find the start and the longest end.
+  if (found == LAZY_DFA_GAVE_UP)
+    max_start = str_len;
+
+  found = search_string_in_nfa_with(r->n, c->nfa, str, str_len, max_start,
+                                    start, end);
+
+  if (found == 1) {
+    *start += skipped;
+    *end += skipped;
+  }
+
+  return found;
+}
+
+int regex_search(const regex *r, const char *str, int str_len, int *start,
+                 int *end) {
+  if (r == NULL || str == NULL || start == NULL || end == NULL)
     return -1;
+
+  regex_match_context *c = regex_borrow_context(r);
+
+  if (c == NULL)
+    return -1;
+
+  REGEX_STATS_ONLY(uint64_t started = regex_stats_now_ns();)
+
+  int heap_allocations = context_heap_allocations(c);
+  int found = regex_search_with(c, str, str_len, start, end);
+
+  REGEX_STATS_ONLY(__atomic_fetch_add(&r->runtime->counters.match_ns,
+                                      regex_stats_now_ns() - started,
+                                      __ATOMIC_RELAXED);)
+
+  record_match(r, c, heap_allocations);
+  regex_return_context(r, c);
+
+  return found;
+}
+
+// every context made for r has to be back in its pool, or be freed by
+// regex_return_context, before r is freed.
+void regex_free(regex *r) {
+  if (r == NULL)
+    return;
+
+  free_dfa(r->full);
+
+  if (r->runtime != NULL) {
+    regex_pool *p = &r->runtime->pool;
+
+    for (int i = 0; i < p->slots_used; i++)
+      free_regex_match_context((regex_match_context *)p->contexts[i]);
+
+    free_dfa(r->runtime->forward);
+    free_dfa(r->runtime->reverse);
   }
 
-  if (show_log)
-    printf("Evaluating '%s' with regular expression '%s'\n", str, regex);
+  free_arena(r->mem);
+}
+
+void regex_get_alloc_stats(const regex *r, regex_alloc_stats *stats) {
+  *stats = r->stats;
+  stats->match_heap_allocations =
+      __atomic_load_n(&r->runtime->match_heap_allocations, __ATOMIC_RELAXED);
+  stats->match_bytes_reserved =
+      __atomic_load_n(&r->runtime->match_bytes_reserved, __ATOMIC_RELAXED);
+}
+
+// a snapshot of the counters, which cover every match and search whose
+// context was given back, so matches running at the same time or contexts
+// still held by a stream or a batch are left out.
+void regex_get_stats(const regex *r, regex_stats *stats) {
+  regex_stats *counters = &r->runtime->counters;
+
+  stats->standardize_ns =
+      __atomic_load_n(&counters->standardize_ns, __ATOMIC_RELAXED);
+  stats->postfix_ns = __atomic_load_n(&counters->postfix_ns, __ATOMIC_RELAXED);
+  stats->nfa_ns = __atomic_load_n(&counters->nfa_ns, __ATOMIC_RELAXED);
+  stats->dfa_ns = __atomic_load_n(&counters->dfa_ns, __ATOMIC_RELAXED);
+  stats->match_ns = __atomic_load_n(&counters->match_ns, __ATOMIC_RELAXED);
+  stats->matches = __atomic_load_n(&counters->matches, __ATOMIC_RELAXED);
+  stats->states = __atomic_load_n(&counters->states, __ATOMIC_RELAXED);
+  stats->closures = __atomic_load_n(&counters->closures, __ATOMIC_RELAXED);
+  stats->queue_high_water =
+      __atomic_load_n(&counters->queue_high_water, __ATOMIC_RELAXED);
+  stats->heap_allocations =
+      __atomic_load_n(&counters->heap_allocations, __ATOMIC_RELAXED);
+  stats->dfa_cache_hits =
+      __atomic_load_n(&counters->dfa_cache_hits, __ATOMIC_RELAXED);
+  stats->dfa_cache_misses =
+      __atomic_load_n(&counters->dfa_cache_misses, __ATOMIC_RELAXED);
+}
+
+// the states of the lazy dfa of a context that no match is using, which is
+// borrowed for the count. without a full dfa or a lazy dfa it is 0.
+int regex_dfa_state_count(const regex *r) {
+  if (r->full != NULL)
+    return r->full->number_of_states;
+
+  regex_match_context *c = regex_borrow_context(r);
+
+  if (c == NULL)
+    return 0;
+
+  int states = c->lazy != NULL ? c->lazy->number_of_states : 0;
+  regex_return_context(r, c);
+
+  return states;
+}
+
+regex_stream *regex_stream_new(const regex *r) {
+  if (r == NULL)
+    return NULL;
+
+  int states_len = r->n->number_of_states;
+  arena *mem = new_arena(sizeof(regex_stream) + sizeof(int) * states_len * 6 +
+                         ARENA_ALIGNMENT * 12);
+
+  if (mem == NULL)
+    return NULL;
+
+  regex_stream *s = (regex_stream *)arena_alloc(mem, sizeof(regex_stream));
+
+  if (s == NULL) {
+    free_arena(mem);
+    return NULL;
+  }
+
+  s->r = r;
+  s->mem = mem;
+  s->context = regex_borrow_context(r);
+  s->set = (int *)arena_alloc(mem, sizeof(int) * (states_len + 1));
+  s->curr = new_sparse_set(states_len, mem);
+  s->next = new_sparse_set(states_len, mem);
+
+  if (s->context == NULL || s->set == NULL || s->curr == NULL ||
+      s->next == NULL) {
+    regex_return_context(r, s->context);
+    free_arena(mem);
+    return NULL;
+  }
+
+  regex_stream_reset(s);
+
+  return s;
+}
+
+void regex_stream_free(regex_stream *s) {
+  if (s == NULL)
+    return;
+
+  regex_return_context(s->r, s->context);
+  free_arena(s->mem);
+}
 
-  int standard_regex_len;
-  int regex_len = strlen(regex);
-  int str_len = strlen(str);
+static void save_stream_set(regex_stream *s) {
+  lazy_dfa *d = s->context->lazy;
+  lazy_dfa_state *state = &d->states[s->state];
 
-  char *standard = standardize_regex(regex, regex_len, &standard_regex_len);
+  memcpy(s->set, d->sets + state->set_offset, sizeof(int) * state->set_len);
+  s->set_len = state->set_len;
+  s->flushes = d->flushes;
+}
+
+void regex_stream_reset(regex_stream *s) {
+  s->in_nfa = 0;
 
-  if (standard == NULL) {
-    printf("There was an issue in the standardization process...");
+  if (s->r->full != NULL) {
+    s->state = s->r->full->init;
+    return;
+  }
+
+  if (s->r->bits != NULL) {
+    glushkov_start(s->r->bits, s->bits);
+    return;
+  }
+
+  s->state = s->context->lazy->init;
+  save_stream_set(s);
+}
+
+int regex_stream_feed(regex_stream *s, const char *buf, int len) {
+  if (s == NULL || buf == NULL)
     return -1;
+
+  const regex *r = s->r;
+
+  if (r->full != NULL) {
+    s->state = dfa_run(r->full, s->state, buf, len);
+    return 0;
   }
 
-  if (show_log)
-    printf("Standardized regular expression: %s\n", standard);
+  if (r->bits != NULL) {
+    glushkov_run(r->bits, s->bits, buf, len);
+    return 0;
+  }
 
-  char *postfix = regex_to_postfix(standard, standard_regex_len);
+  if (!s->in_nfa) {
+    lazy_dfa *d = s->context->lazy;
 
-  if (postfix == NULL) {
-    free(standard);
-    printf("There was an issue in postfix creation process...");
+    // the state id is gone after a flush, but its set is not.
+    if (d->flushes != s->flushes) {
+      s->state = lazy_dfa_add_state(d, s->set, s->set_len);
+
+      if (s->state == DFA_UNKNOWN_STATE) {
+        lazy_dfa_flush(d);
+        s->state = lazy_dfa_add_state(d, s->set, s->set_len);
+      }
+
+      if (s->state == DFA_UNKNOWN_STATE)
+        return -1;
+    }
+
+    int consumed = lazy_dfa_run(d, &s->state, buf, len);
+
+    if (consumed == -1)
+      return -1;
+
+    save_stream_set(s);
+
+    if (consumed == len)
+      return 0;
+
+    // a dfa state holds every state the nfa can read from, already closed
+    // under epsilon transitions, which is all the simulation needs to go on.
+    s->in_nfa = 1;
+    sparse_set_clear(s->curr);
+
+    for (int i = 0; i < s->set_len; i++)
+      sparse_set_add(s->curr, s->set[i]);
+
+    buf += consumed;
+    len -= consumed;
+  }
+
+  for (int i = 0; i < len && s->curr->len > 0; i++) {
+    step_nfa_set(r->n, s->curr, s->next, buf[i]);
+
+    sparse_set *temp = s->curr;
+    s->curr = s->next;
+    s->next = temp;
+  }
+
+  return 0;
+}
+
+int regex_stream_finish(regex_stream *s) {
+  if (s == NULL)
     return -1;
+
+  if (s->r->full != NULL)
+    return s->r->full->accepting[s->state];
+
+  if (s->r->bits != NULL)
+    return glushkov_accepts(s->r->bits, s->bits);
+
+  if (s->in_nfa)
+    return sparse_set_contains(s->curr, s->r->n->final);
+
+  for (int i = 0; i < s->set_len; i++) {
+    if (s->set[i] == s->r->n->final)
+      return 1;
   }
 
-  int postfix_len = strlen(postfix);
+  return 0;
+}
+
+#ifdef REGEX_STATS
+static void print_regex_stats(const regex *r) {
+  regex_stats stats;
+  regex_get_stats(r, &stats);
+
+  printf("\nStandardize: %llu ns, postfix: %llu ns, nfa: %llu ns, "
+         "dfa: %llu ns\n",
+         (unsigned long long)stats.standardize_ns,
+         (unsigned long long)stats.postfix_ns,
+         (unsigned long long)stats.nfa_ns, (unsigned long long)stats.dfa_ns);
+  printf("Matches: %llu in %llu ns\n", (unsigned long long)stats.matches,
+         (unsigned long long)stats.match_ns);
+  printf("States: %i, closures: %llu, queue high water: %i\n", stats.states,
+         (unsigned long long)stats.closures, stats.queue_high_water);
+  printf("Heap allocations: %i, dfa cache hits: %llu, misses: %llu\n",
+         stats.heap_allocations, (unsigned long long)stats.dfa_cache_hits,
+         (unsigned long long)stats.dfa_cache_misses);
+}
+#endif
+
+int evaluate_string(const char *str, const char *regex, int show_log) {
+  if (str == NULL) {
+    printf("The provided string is empty!");
+    return -1;
+  }
+
+  if (regex == NULL) {
+    printf("The provided regex is empty!");
+    return -1;
+  }
 
   if (show_log)
-    printf("Postfix of regular expression: %s\n\n", postfix);
+    printf("Evaluating '%s' with regular expression '%s'\n", str, regex);
 
-  nfa *n = new_nfa_from_regex(postfix, postfix_len);
+  // patterns are compiled once and kept in the process wide cache, which
+  // every caller of a pattern shares the regex from.
+  regex_cache *cache = regex_cache_global();
+  const struct regex *r = regex_cache_acquire(cache, regex, NULL);
 
-  if (n == NULL) {
-    free(postfix);
-    free(standard);
-    printf("There was an issue in nfa creation process...");
+  if (r == NULL) {
+    printf("There was an issue in the compilation process...");
     return -1;
   }
 
   if (show_log) {
-    print_nfa(n);
+    printf("Standardized regular expression: %s\n", r->standard);
+    printf("Postfix of regular expression: %s\n\n", r->postfix);
+    print_nfa(r->n);
     printf("\n");
   }
 
-  int evaluated = evaluate_string_in_nfa(n, str, str_len);
+  int evaluated = regex_match(r, str, strlen(str));
 
   if (show_log) {
     printf("String '%s' is ", str);
@@ -66,23 +816,23 @@ int evaluate_string(const char *str, const char *regex, int show_log) {
       printf("not accepted");
     } else {
       printf("There was an issue in evaluation process...");
-      free_nfa(n);
-      free(postfix);
-      free(standard);
+      regex_cache_release(cache, r);
       return -1;
     }
 
     printf(" with the given regular expression\n");
+    REGEX_STATS_ONLY(print_regex_stats(r);)
   }
 
-  free_nfa(n);
-  free(postfix);
-  free(standard);
+  regex_cache_release(cache, r);
   return evaluated;
 }
 
-char *standardize_regex(const char *regex, int len, int *new_len) {
-  char *standard = (char *)malloc(sizeof(char) * (len * 2) + 1);
+char *standardize_regex(const char *regex, int len, int *new_len, arena *mem) {
+  char *standard = (char *)arena_alloc(mem, sizeof(char) * (len * 2) + 1);
+
+  if (standard == NULL)
+    return NULL;
 
   int i = 0;
   int j = 0;
@@ -100,30 +850,11 @@ char *standardize_regex(const char *regex, int len, int *new_len) {
 
     standard[j++] = curr;
 
-    if ((curr >= 'a' && curr <= 'z') || (curr >= 'A' && curr <= 'Z') ||
-        (curr >= '0' && curr <= '9')) {
-      if ((next >= 'a' && next <= 'z') || (next >= 'A' && next <= 'Z') ||
-          (next >= '0' && next <= '9')) {
-        standard[j++] = '.';
-      }
-
-      if (next == '(') {
-        standard[j++] = '.';
-      }
-    }
-
-    if (curr == '*') {
-      if ((next >= 'a' && next <= 'z') || (next >= 'A' && next <= 'Z') ||
-          (next >= '0' && next <= '9') || next == '(') {
-        standard[j++] = '.';
-      }
-    }
-
-    if (curr == ')') {
-      if ((next >= 'a' && next <= 'z') || (next >= 'A' && next <= 'Z') ||
-          (next >= '0' && next <= '9')) {
-        standard[j++] = '.';
-      }
+    // a concatenation is implicit between a symbol, a closing parenthesis
+    // or a star and whatever symbol or group follows it.
+    if ((is_nfa_symbol(curr) || curr == ')' || curr == '*') &&
+        (is_nfa_symbol(next) || next == '(')) {
+      standard[j++] = '.';
     }
 
     i++;
@@ -135,14 +866,14 @@ char *standardize_regex(const char *regex, int len, int *new_len) {
   return standard;
 }
 
-char *regex_to_postfix(const char *regex, int len) {
-  stack *op = new_stack(len);
+char *regex_to_postfix(const char *regex, int len, arena *mem) {
+  stack *op = new_stack(len, mem);
 
   if (op == NULL) {
     return NULL;
   }
 
-  char *postfix = (char *)malloc(sizeof(char) * (len + 1));
+  char *postfix = (char *)arena_alloc(mem, sizeof(char) * (len + 1));
 
   if (postfix == NULL) {
     free_stack(op);
@@ -153,13 +884,12 @@ char *regex_to_postfix(const char *regex, int len) {
   for (int i = 0; i < len; i++) {
     char c = regex[i];
 
-    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
-        (c >= '0' && c <= '9')) {
+    if (is_nfa_symbol(c)) {
       postfix[j++] = c;
     } else if (c == '(') {
       if (stack_push(op, c) == -1) {
         free_stack(op);
-        free(postfix);
+        arena_release(mem, postfix);
         return NULL;
       }
     } else if (c == ')') {
@@ -183,12 +913,12 @@ char *regex_to_postfix(const char *regex, int len) {
 
       if (stack_push(op, c) == -1) {
         free_stack(op);
-        free(postfix);
+        arena_release(mem, postfix);
         return NULL;
       }
     } else {
       free_stack(op);
-      free(postfix);
+      arena_release(mem, postfix);
       return NULL;
     }
   }
@@ -220,16 +950,19 @@ int operator_precedence(char op) {
   }
 }
 
-stack *new_stack(int max) {
-  stack *s = (stack *)malloc(sizeof(stack));
-  s->data = (char *)malloc(sizeof(char) * max);
+stack *new_stack(int max, arena *mem) {
+  stack *s = (stack *)arena_alloc(mem, sizeof(stack));
+
+  if (s == NULL)
+    return NULL;
+
+  s->data = (char *)arena_alloc(mem, sizeof(char) * max);
   s->top = -1;
   s->max = max;
+  s->mem = mem;
 
   if (s->data == NULL) {
-    if (s != NULL)
-      free(s);
-
+    arena_release(mem, s);
     return NULL;
   }
 
@@ -237,8 +970,8 @@ stack *new_stack(int max) {
 }
 
 void free_stack(stack *s) {
-  free(s->data);
-  free(s);
+  arena_release(s->mem, s->data);
+  arena_release(s->mem, s);
 }
 
 int stack_is_full(stack *s) { return s->top == s->max - 1; }
@@ -1,7 +1,12 @@
 #ifndef REGEX_H_
 #define REGEX_H_
 
+#include "arena.h"
+#include "dfa.h"
+#include "glushkov.h"
+#include "literal.h"
 #include "nfa.h"
+#include "teddy.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -10,11 +15,149 @@ typedef struct stack {
   int top;
   int max;
   char *data;
+  arena *mem;
 } stack;
 
+#define REGEX_OK 0
+#define REGEX_ERR_SYNTAX -1
+#define REGEX_ERR_NO_MEMORY -2
+#define REGEX_ERR_TOO_MANY_STATES -3
+
+#define REGEX_DEFAULT_DFA_CACHE_SIZE (1 << 20)
+#define REGEX_DEFAULT_DFA_STATE_LIMIT 10000
+
+// zeroed fields pick the defaults. with full_dfa set the pattern is
+// determinized and minimized at compile time, which fails with
+// REGEX_ERR_TOO_MANY_STATES once the dfa grows past dfa_state_limit states.
+// no_bit_parallel keeps patterns that fit the glushkov engine on the lazy
+// dfa.
+typedef struct regex_options {
+  size_t dfa_cache_size;
+  int full_dfa;
+  int dfa_state_limit;
+  int no_bit_parallel;
+} regex_options;
+
+// heap traffic of a compiled regex. the compile numbers cover everything the
+// regex owns, the match numbers cover the match context of the last
+// regex_match or regex_search call on any thread, which stays at zero after
+// the first search has built the context's unanchored lazy dfa.
+typedef struct regex_alloc_stats {
+  int compile_heap_allocations;
+  size_t compile_bytes_reserved;
+  int match_heap_allocations;
+  size_t match_bytes_reserved;
+} regex_alloc_stats;
+
+#define REGEX_MAX_POOLED_CONTEXTS 64
+
+// a lock free stack of the contexts in contexts that no thread is using,
+// linked through next. free_head holds the slot on top of it, plus one, in
+// its low half and a tag in its high half that every push and pop changes,
+// so a pop fails when its slot was taken and put back in between.
+// slots_used is how many slots were given a context.
+typedef struct regex_pool {
+  uint64_t free_head;
+  int slots_used;
+  int next[REGEX_MAX_POOLED_CONTEXTS];
+  void *contexts[REGEX_MAX_POOLED_CONTEXTS];
+} regex_pool;
+
+typedef struct regex_match_context regex_match_context;
+
+// everything that changes after a regex is compiled. pool holds the match
+// contexts the regex made for its callers. forward and reverse are the full
+// dfas the parallel matcher builds on its first call, forward only when
+// there is no full dfa to use instead, and the first one built is the one
+// kept. counters are what compiling and matching did, kept only when built
+// with REGEX_STATS, see stats.h. cache_refs is how many callers hold the
+// regex from a regex_cache, plus one while the cache keeps it, and only
+// changes under that cache's lock.
+typedef struct regex_runtime {
+  regex_pool pool;
+  dfa *forward;
+  dfa *reverse;
+  int match_heap_allocations;
+  size_t match_bytes_reserved;
+  regex_stats counters;
+  int cache_refs;
+} regex_runtime;
+
+// a regex and everything it points to lives in mem, and nothing but runtime
+// changes once it is compiled, which only changes through atomics, so one
+// regex can be matched and searched from many threads at once. literals
+// found in the pattern reject strings before any automaton runs, with a
+// teddy when every match holds one of several alternates. matching goes
+// through the full dfa when there is one, then through the glushkov
+// automaton when the pattern has at most 63 symbols, otherwise through the
+// lazy dfa, and only simulates the nfa when the lazy dfa gives up.
+//
+// regex_match and regex_search borrow a match context from the regex's pool
+// for the call. a caller matching many strings can borrow one itself with
+// regex_borrow_context and match with it through regex_match_with and
+// regex_search_with, and has to give it back with regex_return_context
+// before the regex is freed. a borrow only makes a new context when every
+// pooled one is in use, and contexts beyond the pool are freed when they
+// are given back.
+//
+// regex_search finds the leftmost match in str, and the longest one of those
+// starting there, as the offsets [start, end).
+typedef struct regex {
+  char *pattern;
+  char *standard;
+  char *postfix;
+  nfa *n;
+  dfa *full;
+  glushkov *bits;
+  size_t dfa_cache_size;
+  int dfa_state_limit;
+  regex_literals literals;
+  teddy *alternates;
+  arena *mem;
+  regex_runtime *runtime;
+  regex_alloc_stats stats;
+} regex;
+
+// everything a match or a search with r changes, sized from r's nfa when the
+// context is made, so that matches and searches reusing it never touch the
+// heap. lazy is the lazy dfa matches go through, and only exists when r has
+// neither a full dfa nor a glushkov automaton. search is the unanchored lazy
+// dfa, built by the first search with the context, and nfa is what the
+// simulation works in when a lazy dfa gives up. slot is the context's place
+// in r's pool, or -1 for a context outside of it. a context serves one
+// thread at a time.
+struct regex_match_context {
+  const regex *r;
+  int slot;
+  lazy_dfa *lazy;
+  lazy_dfa *search;
+  nfa_scratch *nfa;
+  arena *mem;
+};
+
+// a stream matches one input that is fed to it in pieces, without copying
+// them. it keeps the dfa state, or the glushkov states in bits, between
+// regex_stream_feed calls, and for the lazy dfa also the nfa set behind its
+// state, which outlives a flush of the cache. the stream holds a match
+// context of r's for its whole life, and once the lazy dfa gives up it goes
+// on in the nfa simulation. r has to outlive the stream.
+typedef struct regex_stream {
+  const regex *r;
+  regex_match_context *context;
+  int state;
+  int flushes;
+  int *set;
+  int set_len;
+  int in_nfa;
+  uint64_t bits[GLUSHKOV_MAX_WORDS];
+  sparse_set *curr;
+  sparse_set *next;
+  arena *mem;
+} regex_stream;
+
 void free_stack(stack *s);
 
-stack *new_stack(int max);
+stack *new_stack(int max, arena *mem);
 int stack_is_full(stack *s);
 int stack_is_empty(stack *s);
 char stack_top(stack *s);
@@ -22,9 +165,38 @@ int stack_push(stack *s, char state);
 int stack_pop(stack *s, char *state);
 
 int operator_precedence(char op);
-char *regex_to_postfix(const char *regex, int len);
+char *regex_to_postfix(const char *regex, int len, arena *mem);
+
+char *standardize_regex(const char *regex, int len, int *new_len, arena *mem);
+
+regex *regex_compile(const char *pattern);
+regex *regex_compile_with_options(const char *pattern,
+                                  const regex_options *options, int *err);
+int regex_match(const regex *r, const char *str, int str_len);
+int regex_match_with(regex_match_context *c, const char *str, int str_len);
+int regex_search(const regex *r, const char *str, int str_len, int *start,
+                 int *end);
+int regex_search_with(regex_match_context *c, const char *str, int str_len,
+                      int *start, int *end);
+void regex_free(regex *r);
+
+void *regex_pool_pop(regex_pool *p);
+int regex_pool_add(regex_pool *p, void *c);
+void regex_pool_push(regex_pool *p, int slot);
+
+regex_match_context *new_regex_match_context(const regex *r);
+void free_regex_match_context(regex_match_context *c);
+regex_match_context *regex_borrow_context(const regex *r);
+void regex_return_context(const regex *r, regex_match_context *c);
+void regex_get_alloc_stats(const regex *r, regex_alloc_stats *stats);
+void regex_get_stats(const regex *r, regex_stats *stats);
+int regex_dfa_state_count(const regex *r);
 
-char *standardize_regex(const char *regex, int len, int *new_len);
+regex_stream *regex_stream_new(const regex *r);
+void regex_stream_free(regex_stream *s);
+void regex_stream_reset(regex_stream *s);
+int regex_stream_feed(regex_stream *s, const char *buf, int len);
+int regex_stream_finish(regex_stream *s);
 
 int evaluate_string(const char *str, const char *regex, int show_log);
 
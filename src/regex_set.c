@@ -0,0 +1,335 @@
+#include "regex_set.h"
+
+static regex_set *fail_set_compile(regex_set *s, arena *mem, int *err,
+                                   int code) {
+  if (s != NULL)
+    regex_set_free(s);
+  else
+    free_arena(mem);
+
+  if (err != NULL)
+    *err = code;
+
+  return NULL;
+}
+
+regex_set *regex_set_compile(const char **patterns, int count,
+                             const regex_options *options, int *err) {
+  if (patterns == NULL || count < 0)
+    return fail_set_compile(NULL, NULL, err, REGEX_ERR_SYNTAX);
+
+  size_t dfa_cache_size = REGEX_DEFAULT_DFA_CACHE_SIZE;
+
+  // the set is always matched through the lazy dfa, a full dfa would need
+  // to remember the patterns behind every accepting state.
+  if (options != NULL && options->dfa_cache_size > 0)
+    dfa_cache_size = options->dfa_cache_size;
+
+  size_t patterns_len = 0;
+
+  for (int i = 0; i < count; i++) {
+    if (patterns[i] == NULL)
+      return fail_set_compile(NULL, NULL, err, REGEX_ERR_SYNTAX);
+
+    patterns_len += strlen(patterns[i]);
+  }
+
+  arena *mem = new_arena(patterns_len * 96 + (size_t)count * 64 + 1024);
+
+  if (mem == NULL)
+    return fail_set_compile(NULL, NULL, err, REGEX_ERR_NO_MEMORY);
+
+  const char **postfixes =
+      (const char **)arena_alloc(mem, sizeof(char *) * (count + 1));
+  int *postfix_lens = (int *)arena_alloc(mem, sizeof(int) * (count + 1));
+
+  // a line can only match when it holds a literal of some pattern, which
+  // is what the teddy looks for. a pattern without literals can match
+  // anything, and past REGEX_SET_MAX_LITERALS literals nearly every byte is
+  // a candidate, so either leaves the set without a prefilter. the first
+  // pass only counts the literals and their bytes.
+  regex_literals *pattern_literals =
+      (regex_literals *)arena_alloc(mem, sizeof(regex_literals));
+  int literals_len = 0;
+  size_t copies_len = 0;
+  int has_prefilter = count > 0;
+
+  if (postfixes == NULL || postfix_lens == NULL || pattern_literals == NULL)
+    return fail_set_compile(NULL, mem, err, REGEX_ERR_NO_MEMORY);
+
+  for (int i = 0; i < count; i++) {
+    int standard_len;
+    char *standard = standardize_regex(patterns[i], strlen(patterns[i]),
+                                       &standard_len, mem);
+
+    if (standard == NULL)
+      return fail_set_compile(NULL, mem, err, REGEX_ERR_NO_MEMORY);
+
+    char *postfix = regex_to_postfix(standard, standard_len, mem);
+
+    if (postfix == NULL)
+      return fail_set_compile(NULL, mem, err, REGEX_ERR_SYNTAX);
+
+    postfixes[i] = postfix;
+    postfix_lens[i] = strlen(postfix);
+
+    if (!has_prefilter)
+      continue;
+
+    regex_literals *l = pattern_literals;
+
+    if (find_regex_literals(postfix, postfix_lens[i], l, mem) == -1)
+      return fail_set_compile(NULL, mem, err, REGEX_ERR_SYNTAX);
+
+    if (l->scan_alternates) {
+      literals_len += l->alternates_len;
+
+      for (int k = 0; k < l->alternates_len; k++)
+        copies_len += l->alternate_lens[k];
+    } else if (l->required_len > 0) {
+      literals_len++;
+      copies_len += l->required_len;
+    } else {
+      has_prefilter = 0;
+    }
+
+    if (literals_len > REGEX_SET_MAX_LITERALS)
+      has_prefilter = 0;
+  }
+
+  // the next pattern overwrites pattern_literals, so the second pass copies
+  // the literals out of it.
+  const char **literals = NULL;
+  int *literal_lens = NULL;
+
+  if (has_prefilter) {
+    literals = (const char **)arena_alloc(mem, sizeof(char *) * literals_len);
+    literal_lens = (int *)arena_alloc(mem, sizeof(int) * literals_len);
+    char *copies = (char *)arena_alloc(mem, copies_len + 1);
+
+    if (literals == NULL || literal_lens == NULL || copies == NULL)
+      return fail_set_compile(NULL, mem, err, REGEX_ERR_NO_MEMORY);
+
+    int len = 0;
+
+    for (int i = 0; i < count; i++) {
+      regex_literals *l = pattern_literals;
+
+      if (find_regex_literals(postfixes[i], postfix_lens[i], l, mem) == -1)
+        return fail_set_compile(NULL, mem, err, REGEX_ERR_SYNTAX);
+
+      if (l->scan_alternates) {
+        for (int k = 0; k < l->alternates_len; k++) {
+          memcpy(copies, l->alternates[k], l->alternate_lens[k]);
+          literals[len] = copies;
+          literal_lens[len++] = l->alternate_lens[k];
+          copies += l->alternate_lens[k];
+        }
+      } else {
+        memcpy(copies, l->required, l->required_len);
+        literals[len] = copies;
+        literal_lens[len++] = l->required_len;
+        copies += l->required_len;
+      }
+    }
+  }
+
+  regex_set *s = (regex_set *)arena_alloc(mem, sizeof(regex_set));
+
+  if (s == NULL)
+    return fail_set_compile(NULL, mem, err, REGEX_ERR_NO_MEMORY);
+
+  s->number_of_patterns = count;
+  s->dfa_cache_size = dfa_cache_size;
+  s->mem = mem;
+  s->prefilter = NULL;
+  s->pool = (regex_pool *)arena_alloc(mem, sizeof(regex_pool));
+
+  if (s->pool == NULL)
+    return fail_set_compile(NULL, mem, err, REGEX_ERR_NO_MEMORY);
+
+  memset(s->pool, 0, sizeof(regex_pool));
+
+  if (has_prefilter) {
+    s->prefilter = new_teddy(literals, literal_lens, literals_len, mem);
+
+    if (s->prefilter == NULL)
+      return fail_set_compile(s, mem, err, REGEX_ERR_NO_MEMORY);
+  }
+
+  s->n = new_nfa_from_regexes(postfixes, postfix_lens, count, mem);
+
+  if (s->n == NULL)
+    return fail_set_compile(s, mem, err, REGEX_ERR_SYNTAX);
+
+  // the first context is pooled right away, so a set only used from one
+  // thread never makes another.
+  regex_set_context *c = regex_set_borrow_context(s);
+
+  if (c == NULL)
+    return fail_set_compile(s, mem, err, REGEX_ERR_NO_MEMORY);
+
+  regex_set_return_context(s, c);
+
+  if (err != NULL)
+    *err = REGEX_OK;
+
+  return s;
+}
+
+regex_set_context *new_regex_set_context(const regex_set *s) {
+  if (s == NULL)
+    return NULL;
+
+  int states_len = s->n->number_of_states;
+  arena *mem = new_arena(sizeof(regex_set_context) +
+                         sizeof(int) * states_len * 5 + ARENA_ALIGNMENT * 8);
+
+  if (mem == NULL)
+    return NULL;
+
+  regex_set_context *c =
+      (regex_set_context *)arena_alloc(mem, sizeof(regex_set_context));
+
+  if (c == NULL) {
+    free_arena(mem);
+    return NULL;
+  }
+
+  c->s = s;
+  c->slot = -1;
+  c->mem = mem;
+  c->curr = new_sparse_set(states_len, mem);
+  c->next = new_sparse_set(states_len, mem);
+  c->lazy = new_lazy_dfa(s->n, s->dfa_cache_size, 0);
+
+  if (c->curr == NULL || c->next == NULL || c->lazy == NULL) {
+    free_regex_set_context(c);
+    return NULL;
+  }
+
+  return c;
+}
+
+void free_regex_set_context(regex_set_context *c) {
+  if (c == NULL)
+    return;
+
+  free_lazy_dfa(c->lazy);
+  free_arena(c->mem);
+}
+
+regex_set_context *regex_set_borrow_context(const regex_set *s) {
+  regex_set_context *c = (regex_set_context *)regex_pool_pop(s->pool);
+
+  if (c != NULL)
+    return c;
+
+  c = new_regex_set_context(s);
+
+  if (c != NULL)
+    c->slot = regex_pool_add(s->pool, c);
+
+  return c;
+}
+
+void regex_set_return_context(const regex_set *s, regex_set_context *c) {
+  if (c == NULL)
+    return;
+
+  if (c->slot == -1)
+    free_regex_set_context(c);
+  else
+    regex_pool_push(s->pool, c->slot);
+}
+
+int regex_set_match(const regex_set *s, const char *str, int str_len,
+                    char *matched) {
+  if (s == NULL || str == NULL || matched == NULL)
+    return -1;
+
+  regex_set_context *c = regex_set_borrow_context(s);
+
+  if (c == NULL)
+    return -1;
+
+  int matches = regex_set_match_with(c, str, str_len, matched);
+  regex_set_return_context(s, c);
+
+  return matches;
+}
+
+int regex_set_match_with(regex_set_context *c, const char *str, int str_len,
+                         char *matched) {
+  if (c == NULL || str == NULL || matched == NULL)
+    return -1;
+
+  const regex_set *s = c->s;
+  nfa *n = s->n;
+  lazy_dfa *d = c->lazy;
+  const int *set;
+  int set_len;
+
+  memset(matched, 0, s->number_of_patterns);
+
+  if (s->prefilter != NULL &&
+      teddy_find(s->prefilter, str, str_len, NULL) == -1)
+    return 0;
+
+  int state = d->init;
+  int consumed = lazy_dfa_run(d, &state, str, str_len);
+
+  if (consumed == -1)
+    return -1;
+
+  if (consumed == str_len) {
+    lazy_dfa_state *final = &d->states[state];
+    set = d->sets + final->set_offset;
+    set_len = final->set_len;
+  } else {
+    // the lazy dfa gave up, its last state holds every state the nfa can
+    // read from and the simulation goes on from there.
+    lazy_dfa_state *last = &d->states[state];
+
+    sparse_set_clear(c->curr);
+
+    for (int i = 0; i < last->set_len; i++)
+      sparse_set_add(c->curr, d->sets[last->set_offset + i]);
+
+    for (int i = consumed; i < str_len && c->curr->len > 0; i++) {
+      step_nfa_set(n, c->curr, c->next, str[i]);
+
+      sparse_set *temp = c->curr;
+      c->curr = c->next;
+      c->next = temp;
+    }
+
+    set = c->curr->dense;
+    set_len = c->curr->len;
+  }
+
+  int matches = 0;
+
+  for (int i = 0; i < set_len; i++) {
+    int id = n->pattern_ids[set[i]];
+
+    if (id != NFA_NO_STATE && !matched[id]) {
+      matched[id] = 1;
+      matches++;
+    }
+  }
+
+  return matches;
+}
+
+// every context made for s has to be back in its pool, or be freed by
+// regex_set_return_context, before s is freed.
+void regex_set_free(regex_set *s) {
+  if (s == NULL)
+    return;
+
+  for (int i = 0; i < s->pool->slots_used; i++)
+    free_regex_set_context((regex_set_context *)s->pool->contexts[i]);
+
+  free_arena(s->mem);
+}
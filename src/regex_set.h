@@ -0,0 +1,62 @@
+#ifndef REGEX_SET_H_
+#define REGEX_SET_H_
+
+#include "arena.h"
+#include "dfa.h"
+#include "nfa.h"
+#include "regex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REGEX_SET_MAX_LITERALS 64
+
+typedef struct regex_set_context regex_set_context;
+
+// a set joins the nfas of all its patterns under one initial state, so a
+// single pass over the input tells which of them match. the final state of
+// pattern i is marked with i in the nfa's pattern_ids, and the dfa state the
+// pass ends in holds the final states of every pattern that matched.
+// prefilter is a teddy over the literals of all patterns, or NULL when one
+// of them has none or they are more than REGEX_SET_MAX_LITERALS.
+//
+// like a regex, nothing but pool changes once a set is compiled, so one set
+// can be matched from many threads at once. regex_set_match borrows a
+// context from pool for the call, and a caller matching many strings can
+// borrow one itself for regex_set_match_with.
+typedef struct regex_set {
+  int number_of_patterns;
+  nfa *n;
+  size_t dfa_cache_size;
+  teddy *prefilter;
+  regex_pool *pool;
+  arena *mem;
+} regex_set;
+
+// everything a match with s changes: the lazy dfa the match goes through,
+// and the sets the nfa simulation works in when the lazy dfa gives up. slot
+// is the context's place in s's pool, or -1 for a context outside of it. a
+// context serves one thread at a time.
+struct regex_set_context {
+  const regex_set *s;
+  int slot;
+  lazy_dfa *lazy;
+  sparse_set *curr;
+  sparse_set *next;
+  arena *mem;
+};
+
+regex_set *regex_set_compile(const char **patterns, int count,
+                             const regex_options *options, int *err);
+int regex_set_match(const regex_set *s, const char *str, int str_len,
+                    char *matched);
+int regex_set_match_with(regex_set_context *c, const char *str, int str_len,
+                         char *matched);
+void regex_set_free(regex_set *s);
+
+regex_set_context *new_regex_set_context(const regex_set *s);
+void free_regex_set_context(regex_set_context *c);
+regex_set_context *regex_set_borrow_context(const regex_set *s);
+void regex_set_return_context(const regex_set *s, regex_set_context *c);
+
+#endif
@@ -0,0 +1,381 @@
+#ifndef STATIC_REGEX_H_
+#define STATIC_REGEX_H_
+
+// a c++20 front end that compiles a pattern known at build time, like
+// static_regex<"ab(ab)*">::match(str). the pattern goes through the same
+// steps as regex_compile, standardize_regex, regex_to_postfix, the thompson
+// construction and the subset construction, all in constexpr functions, so
+// a pattern the runtime rejects does not compile and matching only reads
+// tables the compiler put in read only data.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#define STATIC_REGEX_MAX_STATES 1024
+
+namespace static_regex_detail {
+
+// a string literal that can be a template argument.
+template <std::size_t N> struct pattern_string {
+  char data[N] = {};
+
+  constexpr pattern_string(const char (&str)[N]) {
+    for (std::size_t i = 0; i < N; i++)
+      data[i] = str[i];
+  }
+
+  constexpr int size() const { return N - 1; }
+};
+
+constexpr bool is_symbol(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9');
+}
+
+constexpr int precedence(char op) {
+  return op == '|' ? 1 : op == '.' ? 2 : op == '*' ? 3 : 0;
+}
+
+// standardizing can double the pattern, and the postfix is never longer
+// than the standardized pattern.
+template <std::size_t N> struct postfix {
+  char data[2 * N + 1] = {};
+  int len = 0;
+  bool valid = true;
+};
+
+template <std::size_t N>
+constexpr postfix<N> to_postfix(const pattern_string<N> &pattern) {
+  char standard[2 * N + 1] = {};
+  int standard_len = 0;
+  int len = pattern.size();
+
+  for (int i = 0; i < len; i++) {
+    char curr = pattern.data[i];
+    standard[standard_len++] = curr;
+
+    if (i == len - 1)
+      continue;
+
+    char next = pattern.data[i + 1];
+
+    if ((is_symbol(curr) || curr == ')' || curr == '*') &&
+        (is_symbol(next) || next == '('))
+      standard[standard_len++] = '.';
+  }
+
+  postfix<N> p;
+  char op[2 * N + 1] = {};
+  int op_len = 0;
+
+  for (int i = 0; i < standard_len; i++) {
+    char c = standard[i];
+
+    if (is_symbol(c)) {
+      p.data[p.len++] = c;
+    } else if (c == '(') {
+      op[op_len++] = c;
+    } else if (c == ')') {
+      while (op_len > 0 && op[op_len - 1] != '(')
+        p.data[p.len++] = op[--op_len];
+
+      if (op_len > 0)
+        op_len--;
+    } else if (c == '*' || c == '|' || c == '.') {
+      while (op_len > 0 && precedence(c) <= precedence(op[op_len - 1]))
+        p.data[p.len++] = op[--op_len];
+
+      op[op_len++] = c;
+    } else {
+      p.valid = false;
+      return p;
+    }
+  }
+
+  while (op_len > 0)
+    p.data[p.len++] = op[--op_len];
+
+  return p;
+}
+
+// a thompson nfa where every state has a symbol transition to next, or up to
+// two epsilon transitions.
+template <std::size_t N> struct nfa {
+  static constexpr int max_states = 4 * N + 2;
+
+  char symbol[max_states] = {};
+  int next[max_states] = {};
+  int epsilon[max_states][2] = {};
+  int epsilon_len[max_states] = {};
+  int len = 0;
+  int init = -1;
+  int final = -1;
+  bool valid = true;
+
+  constexpr int add_state() {
+    next[len] = -1;
+    return len++;
+  }
+
+  constexpr void add_epsilon(int from, int to) {
+    epsilon[from][epsilon_len[from]++] = to;
+  }
+};
+
+template <std::size_t N>
+constexpr nfa<N> to_nfa(const pattern_string<N> &pattern) {
+  postfix<N> p = to_postfix(pattern);
+  nfa<N> n;
+
+  if (!p.valid) {
+    n.valid = false;
+    return n;
+  }
+
+  int inits[2 * N + 2] = {};
+  int finals[2 * N + 2] = {};
+  int top = 0;
+
+  if (p.len == 0) {
+    inits[0] = n.add_state();
+    finals[0] = n.add_state();
+    n.add_epsilon(inits[0], finals[0]);
+    top = 1;
+  }
+
+  for (int i = 0; i < p.len; i++) {
+    char c = p.data[i];
+
+    if (is_symbol(c)) {
+      int init = n.add_state();
+      int final = n.add_state();
+      n.symbol[init] = c;
+      n.next[init] = final;
+      inits[top] = init;
+      finals[top++] = final;
+    } else if (c == '*' && top >= 1) {
+      int init = n.add_state();
+      int final = n.add_state();
+      n.add_epsilon(init, inits[top - 1]);
+      n.add_epsilon(init, final);
+      n.add_epsilon(finals[top - 1], inits[top - 1]);
+      n.add_epsilon(finals[top - 1], final);
+      inits[top - 1] = init;
+      finals[top - 1] = final;
+    } else if (c == '.' && top >= 2) {
+      n.add_epsilon(finals[top - 2], inits[top - 1]);
+      finals[top - 2] = finals[top - 1];
+      top--;
+    } else if (c == '|' && top >= 2) {
+      int init = n.add_state();
+      int final = n.add_state();
+      n.add_epsilon(init, inits[top - 2]);
+      n.add_epsilon(init, inits[top - 1]);
+      n.add_epsilon(finals[top - 2], final);
+      n.add_epsilon(finals[top - 1], final);
+      top--;
+      inits[top - 1] = init;
+      finals[top - 1] = final;
+    } else {
+      n.valid = false;
+      return n;
+    }
+  }
+
+  if (top != 1) {
+    n.valid = false;
+    return n;
+  }
+
+  n.init = inits[0];
+  n.final = finals[0];
+  return n;
+}
+
+// a dfa with room for STATIC_REGEX_MAX_STATES states, whose sets of nfa
+// states are kept as bitsets. state 0 is the dead state, state 1 the
+// initial one, and class 0 holds the bytes the pattern does not use.
+template <std::size_t N> struct dfa_builder {
+  static constexpr int words = (nfa<N>::max_states + 63) / 64;
+
+  std::uint64_t sets[STATIC_REGEX_MAX_STATES][words] = {};
+  int transitions[STATIC_REGEX_MAX_STATES][64] = {};
+  bool accepting[STATIC_REGEX_MAX_STATES] = {};
+  unsigned char byte_classes[256] = {};
+  char symbols[64] = {};
+  int number_of_states = 0;
+  int number_of_classes = 1;
+  bool valid = true;
+};
+
+template <std::size_t N>
+constexpr void add_closure(const nfa<N> &n, std::uint64_t *set, int s) {
+  int stack[nfa<N>::max_states] = {};
+  int top = 0;
+
+  if (set[s / 64] & (std::uint64_t(1) << (s % 64)))
+    return;
+
+  set[s / 64] |= std::uint64_t(1) << (s % 64);
+  stack[top++] = s;
+
+  while (top > 0) {
+    int from = stack[--top];
+
+    for (int i = 0; i < n.epsilon_len[from]; i++) {
+      int to = n.epsilon[from][i];
+
+      if (!(set[to / 64] & (std::uint64_t(1) << (to % 64)))) {
+        set[to / 64] |= std::uint64_t(1) << (to % 64);
+        stack[top++] = to;
+      }
+    }
+  }
+}
+
+template <std::size_t N>
+constexpr int add_dfa_state(const nfa<N> &n, dfa_builder<N> &b,
+                            const std::uint64_t *set) {
+  constexpr int words = dfa_builder<N>::words;
+
+  for (int s = 0; s < b.number_of_states; s++) {
+    bool same = true;
+
+    for (int w = 0; w < words && same; w++)
+      same = b.sets[s][w] == set[w];
+
+    if (same)
+      return s;
+  }
+
+  if (b.number_of_states == STATIC_REGEX_MAX_STATES) {
+    b.valid = false;
+    return 0;
+  }
+
+  int s = b.number_of_states++;
+
+  for (int w = 0; w < words; w++)
+    b.sets[s][w] = set[w];
+
+  b.accepting[s] = set[n.final / 64] & (std::uint64_t(1) << (n.final % 64));
+  return s;
+}
+
+template <std::size_t N>
+constexpr dfa_builder<N> to_dfa(const pattern_string<N> &pattern) {
+  constexpr int words = dfa_builder<N>::words;
+  nfa<N> n = to_nfa(pattern);
+  dfa_builder<N> b;
+
+  if (!n.valid) {
+    b.valid = false;
+    return b;
+  }
+
+  for (int s = 0; s < n.len; s++) {
+    unsigned char c = n.symbol[s];
+
+    if (c != '\0' && b.byte_classes[c] == 0) {
+      b.symbols[b.number_of_classes] = c;
+      b.byte_classes[c] = b.number_of_classes++;
+    }
+  }
+
+  std::uint64_t set[words] = {};
+  add_dfa_state(n, b, set);
+  add_closure(n, set, n.init);
+  add_dfa_state(n, b, set);
+
+  for (int s = 0; s < b.number_of_states && b.valid; s++) {
+    for (int k = 1; k < b.number_of_classes; k++) {
+      std::uint64_t target[words] = {};
+
+      for (int q = 0; q < n.len; q++) {
+        if ((b.sets[s][q / 64] & (std::uint64_t(1) << (q % 64))) &&
+            n.symbol[q] == b.symbols[k])
+          add_closure(n, target, n.next[q]);
+      }
+
+      b.transitions[s][k] = add_dfa_state(n, b, target);
+    }
+  }
+
+  return b;
+}
+
+// the tables of a compiled pattern, sized to fit it exactly.
+template <int States, int Classes> struct dfa_tables {
+  std::array<std::uint16_t, States * Classes> transitions = {};
+  std::array<bool, States> accepting = {};
+  std::array<unsigned char, 256> byte_classes = {};
+};
+
+struct dfa_size {
+  int number_of_states;
+  int number_of_classes;
+  bool valid;
+};
+
+template <std::size_t N>
+constexpr dfa_size measure_dfa(const pattern_string<N> &pattern) {
+  dfa_builder<N> b = to_dfa(pattern);
+  return {b.number_of_states, b.number_of_classes, b.valid};
+}
+
+template <int States, int Classes, std::size_t N>
+constexpr dfa_tables<States, Classes>
+build_dfa_tables(const pattern_string<N> &pattern) {
+  dfa_builder<N> b = to_dfa(pattern);
+  dfa_tables<States, Classes> t;
+
+  for (int s = 0; s < States; s++) {
+    t.accepting[s] = b.accepting[s];
+
+    for (int k = 0; k < Classes; k++)
+      t.transitions[s * Classes + k] = b.transitions[s][k];
+  }
+
+  for (int c = 0; c < 256; c++)
+    t.byte_classes[c] = b.byte_classes[c];
+
+  return t;
+}
+
+} // namespace static_regex_detail
+
+template <static_regex_detail::pattern_string Pattern> struct static_regex {
+  static constexpr static_regex_detail::dfa_size size =
+      static_regex_detail::measure_dfa(Pattern);
+
+  static_assert(size.valid, "the pattern is not a valid regular expression, "
+                            "or needs more than STATIC_REGEX_MAX_STATES "
+                            "dfa states");
+
+  static constexpr int number_of_states = size.number_of_states;
+  static constexpr int number_of_classes = size.number_of_classes;
+
+  static constexpr static_regex_detail::dfa_tables<number_of_states,
+                                                   number_of_classes>
+      tables = static_regex_detail::build_dfa_tables<number_of_states,
+                                                     number_of_classes>(
+          Pattern);
+
+  static constexpr bool match(std::string_view str) {
+    int s = 1;
+
+    for (char c : str) {
+      s = tables.transitions[s * number_of_classes +
+                             tables.byte_classes[(unsigned char)c]];
+
+      if (s == 0)
+        return false;
+    }
+
+    return tables.accepting[s];
+  }
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdint.h>
+#include <time.h>
+
+// what compiling and matching a regex did, filled only when the library is
+// built with REGEX_STATS defined. without it REGEX_STATS_ONLY drops its
+// arguments, so the counters cost nothing and every field stays zero.
+//
+// the nanoseconds are per phase of regex_compile, with dfa_ns covering
+// everything built after the nfa, and match_ns sums every regex_match and
+// regex_search call. states counts the nfa states and the dfa states built,
+// closures the epsilon closures computed, and queue_high_water the most nfa
+// states a dfa state was built from. the dfa cache hits and misses are the
+// transitions of the lazy dfas that were found or had to be built.
+typedef struct regex_stats {
+  uint64_t standardize_ns;
+  uint64_t postfix_ns;
+  uint64_t nfa_ns;
+  uint64_t dfa_ns;
+  uint64_t match_ns;
+  uint64_t matches;
+  int states;
+  uint64_t closures;
+  int queue_high_water;
+  int heap_allocations;
+  uint64_t dfa_cache_hits;
+  uint64_t dfa_cache_misses;
+} regex_stats;
+
+#ifdef REGEX_STATS
+#define REGEX_STATS_ONLY(...) __VA_ARGS__
+#else
+#define REGEX_STATS_ONLY(...)
+#endif
+
+static inline uint64_t regex_stats_now_ns() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+#endif
@@ -0,0 +1,257 @@
+#include "teddy.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TEDDY_X86 1
+#endif
+
+int teddy_best_engine() {
+#ifdef TEDDY_X86
+  if (__builtin_cpu_supports("avx2"))
+    return TEDDY_AVX2;
+
+  if (__builtin_cpu_supports("ssse3"))
+    return TEDDY_SSSE3;
+#endif
+
+  return TEDDY_SCALAR;
+}
+
+teddy *new_teddy(const char **literals, const int *lens, int count,
+                 arena *mem) {
+  if (count <= 0)
+    return NULL;
+
+  int min_len = lens[0];
+  size_t literals_size = 0;
+
+  for (int i = 0; i < count; i++) {
+    if (lens[i] <= 0)
+      return NULL;
+
+    if (lens[i] < min_len)
+      min_len = lens[i];
+
+    literals_size += lens[i];
+  }
+
+  teddy *t = (teddy *)arena_alloc(mem, sizeof(teddy));
+
+  if (t == NULL)
+    return NULL;
+
+  t->number_of_literals = count;
+  t->mask_len = min_len < TEDDY_MAX_MASK_LEN ? min_len : TEDDY_MAX_MASK_LEN;
+  t->engine = teddy_best_engine();
+  t->mem = mem;
+  t->literals = (char **)arena_alloc(mem, sizeof(char *) * count);
+  t->lens = (int *)arena_alloc(mem, sizeof(int) * count);
+  t->bucket_literals = (int *)arena_alloc(mem, sizeof(int) * count);
+
+  // the literals are copied into one block, so the teddy does not depend
+  // on the memory of its caller.
+  char *copies = (char *)arena_alloc(mem, literals_size);
+
+  if (t->literals == NULL || t->lens == NULL || t->bucket_literals == NULL ||
+      copies == NULL) {
+    arena_release(mem, copies);
+    arena_release(mem, t->bucket_literals);
+    arena_release(mem, t->lens);
+    arena_release(mem, t->literals);
+    arena_release(mem, t);
+    return NULL;
+  }
+
+  memset(t->lo, 0, sizeof(t->lo));
+  memset(t->hi, 0, sizeof(t->hi));
+
+  for (int i = 0; i < count; i++) {
+    memcpy(copies, literals[i], lens[i]);
+    t->literals[i] = copies;
+    t->lens[i] = lens[i];
+    copies += lens[i];
+  }
+
+  // literal i goes to bucket i % TEDDY_BUCKETS, and the bucket lists are
+  // laid out one after another like the nfa closures.
+  int at = 0;
+
+  for (int b = 0; b < TEDDY_BUCKETS; b++) {
+    t->bucket_offsets[b] = at;
+
+    for (int i = b; i < count; i += TEDDY_BUCKETS) {
+      t->bucket_literals[at++] = i;
+
+      for (int k = 0; k < t->mask_len; k++) {
+        unsigned char c = (unsigned char)t->literals[i][k];
+        t->lo[k][c & 0x0f] |= 1 << b;
+        t->hi[k][c >> 4] |= 1 << b;
+      }
+    }
+  }
+
+  t->bucket_offsets[TEDDY_BUCKETS] = at;
+
+  return t;
+}
+
+void free_teddy(teddy *t) {
+  if (t == NULL)
+    return;
+
+  // the copies of the literals start at the first one.
+  arena_release(t->mem, t->literals[0]);
+  arena_release(t->mem, t->bucket_literals);
+  arena_release(t->mem, t->lens);
+  arena_release(t->mem, t->literals);
+  arena_release(t->mem, t);
+}
+
+static int verify_candidate(const teddy *t, const char *str, int str_len,
+                            int at, unsigned int buckets, int *literal) {
+  while (buckets != 0) {
+    int b = __builtin_ctz(buckets);
+    buckets &= buckets - 1;
+
+    for (int i = t->bucket_offsets[b]; i < t->bucket_offsets[b + 1]; i++) {
+      int l = t->bucket_literals[i];
+
+      if (at + t->lens[l] <= str_len &&
+          memcmp(str + at, t->literals[l], t->lens[l]) == 0) {
+        if (literal != NULL)
+          *literal = l;
+
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+static int teddy_find_scalar(const teddy *t, const char *str, int str_len,
+                             int from, int *literal) {
+  for (int i = from; i + t->mask_len <= str_len; i++) {
+    unsigned int buckets = 0xff;
+
+    for (int k = 0; k < t->mask_len && buckets != 0; k++) {
+      unsigned char c = (unsigned char)str[i + k];
+      buckets &= t->lo[k][c & 0x0f] & t->hi[k][c >> 4];
+    }
+
+    if (buckets != 0 &&
+        verify_candidate(t, str, str_len, i, buckets, literal))
+      return i;
+  }
+
+  return -1;
+}
+
+#ifdef TEDDY_X86
+__attribute__((target("ssse3"))) static int
+teddy_find_ssse3(const teddy *t, const char *str, int str_len, int *literal) {
+  __m128i lo[TEDDY_MAX_MASK_LEN];
+  __m128i hi[TEDDY_MAX_MASK_LEN];
+  __m128i nibble = _mm_set1_epi8(0x0f);
+  unsigned char buckets[16];
+
+  for (int k = 0; k < t->mask_len; k++) {
+    lo[k] = _mm_loadu_si128((const __m128i *)t->lo[k]);
+    hi[k] = _mm_loadu_si128((const __m128i *)t->hi[k]);
+  }
+
+  // the k-th load starts k bytes later, so byte j of the result is the
+  // bucket set of a literal starting at i + j.
+  int i = 0;
+
+  for (; i + 16 + t->mask_len - 1 <= str_len; i += 16) {
+    __m128i res = _mm_set1_epi8((char)0xff);
+
+    for (int k = 0; k < t->mask_len; k++) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(str + i + k));
+      __m128i l = _mm_shuffle_epi8(lo[k], _mm_and_si128(v, nibble));
+      __m128i h = _mm_shuffle_epi8(
+          hi[k], _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+      res = _mm_and_si128(res, _mm_and_si128(l, h));
+    }
+
+    unsigned int candidates =
+        ~_mm_movemask_epi8(_mm_cmpeq_epi8(res, _mm_setzero_si128())) & 0xffff;
+
+    if (candidates == 0)
+      continue;
+
+    _mm_storeu_si128((__m128i *)buckets, res);
+
+    while (candidates != 0) {
+      int j = __builtin_ctz(candidates);
+      candidates &= candidates - 1;
+
+      if (verify_candidate(t, str, str_len, i + j, buckets[j], literal))
+        return i + j;
+    }
+  }
+
+  return teddy_find_scalar(t, str, str_len, i, literal);
+}
+
+__attribute__((target("avx2"))) static int
+teddy_find_avx2(const teddy *t, const char *str, int str_len, int *literal) {
+  __m256i lo[TEDDY_MAX_MASK_LEN];
+  __m256i hi[TEDDY_MAX_MASK_LEN];
+  __m256i nibble = _mm256_set1_epi8(0x0f);
+  unsigned char buckets[32];
+
+  // pshufb looks up within each 128 bit lane, so both lanes get the table.
+  for (int k = 0; k < t->mask_len; k++) {
+    lo[k] = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)t->lo[k]));
+    hi[k] = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i *)t->hi[k]));
+  }
+
+  int i = 0;
+
+  for (; i + 32 + t->mask_len - 1 <= str_len; i += 32) {
+    __m256i res = _mm256_set1_epi8((char)0xff);
+
+    for (int k = 0; k < t->mask_len; k++) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(str + i + k));
+      __m256i l = _mm256_shuffle_epi8(lo[k], _mm256_and_si256(v, nibble));
+      __m256i h = _mm256_shuffle_epi8(
+          hi[k], _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+      res = _mm256_and_si256(res, _mm256_and_si256(l, h));
+    }
+
+    unsigned int candidates = ~(unsigned int)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(res, _mm256_setzero_si256()));
+
+    if (candidates == 0)
+      continue;
+
+    _mm256_storeu_si256((__m256i *)buckets, res);
+
+    while (candidates != 0) {
+      int j = __builtin_ctz(candidates);
+      candidates &= candidates - 1;
+
+      if (verify_candidate(t, str, str_len, i + j, buckets[j], literal))
+        return i + j;
+    }
+  }
+
+  return teddy_find_scalar(t, str, str_len, i, literal);
+}
+#endif
+
+int teddy_find(const teddy *t, const char *str, int str_len, int *literal) {
+#ifdef TEDDY_X86
+  if (t->engine == TEDDY_AVX2)
+    return teddy_find_avx2(t, str, str_len, literal);
+
+  if (t->engine == TEDDY_SSSE3)
+    return teddy_find_ssse3(t, str, str_len, literal);
+#endif
+
+  return teddy_find_scalar(t, str, str_len, 0, literal);
+}
@@ -0,0 +1,44 @@
+#ifndef TEDDY_H_
+#define TEDDY_H_
+
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEDDY_BUCKETS 8
+#define TEDDY_MAX_MASK_LEN 3
+
+#define TEDDY_SCALAR 0
+#define TEDDY_SSSE3 1
+#define TEDDY_AVX2 2
+
+// finds the first place where one of many literals starts. the literals are
+// spread over eight buckets, and for each of the first mask_len bytes of a
+// literal, lo and hi map the low and the high nibble of the byte to the
+// buckets whose literals may have it there. a byte of input whose nibble
+// lookups leave a bucket bit set for all mask_len positions is a candidate
+// and is checked against the literals of that bucket. the vector engines do
+// the lookups for 16 or 32 bytes at once with pshufb, and engine is picked
+// from the cpu when the teddy is built.
+typedef struct teddy {
+  int number_of_literals;
+  int mask_len;
+  int engine;
+  unsigned char lo[TEDDY_MAX_MASK_LEN][16];
+  unsigned char hi[TEDDY_MAX_MASK_LEN][16];
+  char **literals;
+  int *lens;
+  int bucket_offsets[TEDDY_BUCKETS + 1];
+  int *bucket_literals;
+  arena *mem;
+} teddy;
+
+int teddy_best_engine();
+
+teddy *new_teddy(const char **literals, const int *lens, int count,
+                 arena *mem);
+void free_teddy(teddy *t);
+int teddy_find(const teddy *t, const char *str, int str_len, int *literal);
+
+#endif
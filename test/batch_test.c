@@ -0,0 +1,152 @@
+#include "../src/batch.h"
+
+int test_batch(const char *regex, int threads, size_t cache_size,
+               int full_dfa, int no_bit_parallel);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing batches...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *tests_regex_inputs[20];
+  int tests_threads[20];
+  size_t tests_cache_sizes[20];
+  int tests_full_dfas[20];
+  int tests_no_bit_parallels[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_regex_inputs[i] = "";
+    tests_threads[i] = 0;
+    tests_cache_sizes[i] = 0;
+    tests_full_dfas[i] = 0;
+    tests_no_bit_parallels[i] = 0;
+  }
+
+  tests_regex_inputs[0] = "(a|b)*a(a|b)a(a|b)b";
+  tests_threads[0] = 1;
+
+  tests_regex_inputs[1] = "(a|b)*a(a|b)a(a|b)b";
+  tests_threads[1] = 4;
+
+  tests_regex_inputs[2] = "(a|b)*a(a|b)a(a|b)b";
+  tests_threads[2] = 4;
+  tests_no_bit_parallels[2] = 1;
+
+  // every worker flushes its own tiny cache, and some give up on the dfa.
+  tests_regex_inputs[3] = "(a|b)*a(a|b)a(a|b)b";
+  tests_threads[3] = 4;
+  tests_cache_sizes[3] = 1;
+  tests_no_bit_parallels[3] = 1;
+
+  tests_regex_inputs[4] = "(a|b)*a(a|b)a(a|b)b";
+  tests_threads[4] = 3;
+  tests_full_dfas[4] = 1;
+
+  tests_regex_inputs[5] = "(ab|ba)*(a|bb)*";
+  tests_threads[5] = 0;
+
+  for (int i = 0; i < 20; i++) {
+    if (strlen(tests_regex_inputs[i]) == 0) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_batch(tests_regex_inputs[i], tests_threads[i],
+                       tests_cache_sizes[i], tests_full_dfas[i],
+                       tests_no_bit_parallels[i]);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing batches\n\n");
+}
+
+int test_batch(const char *regex, int threads, size_t cache_size,
+               int full_dfa, int no_bit_parallel) {
+  printf("Testing a batch with regex '%s' on %i threads...\n", regex,
+         threads);
+
+  regex_options options;
+  options.dfa_cache_size = cache_size;
+  options.full_dfa = full_dfa;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = no_bit_parallel;
+
+  struct regex *r = regex_compile_with_options(regex, &options, NULL);
+
+  if (r == NULL)
+    return 0;
+
+  // strings of a and b whose bits spell out their index, so every length
+  // and every mix shows up.
+  int count = 5000;
+  int len = 40;
+  char *strs = (char *)malloc(count * len);
+  regex_input *inputs = (regex_input *)malloc(sizeof(regex_input) * count);
+  unsigned char *results = (unsigned char *)malloc((count + 7) / 8);
+
+  for (int i = 0; i < count; i++) {
+    inputs[i].str = strs + i * len;
+    inputs[i].len = i % len;
+
+    for (int k = 0; k < len; k++)
+      strs[i * len + k] = ((i * 2654435761u) >> (k % 32)) & 1 ? 'a' : 'b';
+  }
+
+  int matches = regex_match_batch(r, inputs, count, results, threads);
+  int val = matches >= 0;
+  int expected_matches = 0;
+
+  for (int i = 0; i < count && val; i++) {
+    int evaluated = regex_match(r, inputs[i].str, inputs[i].len);
+
+    if (evaluated != ((results[i / 8] >> (i % 8)) & 1))
+      val = 0;
+
+    expected_matches += evaluated;
+  }
+
+  if (matches != expected_matches)
+    val = 0;
+
+  printf("%i of %i strings matched\n", matches, count);
+
+  free(results);
+  free(inputs);
+  free(strs);
+  regex_free(r);
+  return val;
+}
@@ -0,0 +1,289 @@
+#include "../src/cache.h"
+
+int test_cache(int capacity, const char **patterns, int shrink_to,
+               int expected_hits, int expected_misses,
+               int expected_evictions, int expected_len);
+int test_global_cache();
+int test_shared_entries();
+int test_evict_held();
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing regex caches...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *tests_patterns[20][8];
+  int tests_capacities[20];
+  int tests_shrink_to[20];
+  int tests_hits[20];
+  int tests_misses[20];
+  int tests_evictions[20];
+  int tests_lens[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_patterns[i][0] = NULL;
+    tests_capacities[i] = 0;
+    tests_shrink_to[i] = -1;
+    tests_hits[i] = 0;
+    tests_misses[i] = 0;
+    tests_evictions[i] = 0;
+    tests_lens[i] = 0;
+  }
+
+  const char *t1[] = {"a*b", "a*b", "a*b", NULL};
+  memcpy(tests_patterns[0], t1, sizeof(t1));
+  tests_capacities[0] = 4;
+  tests_hits[0] = 2;
+  tests_misses[0] = 1;
+  tests_lens[0] = 1;
+
+  const char *t2[] = {"a", "b", "c", "a", NULL};
+  memcpy(tests_patterns[1], t2, sizeof(t2));
+  tests_capacities[1] = 2;
+  tests_misses[1] = 4;
+  tests_evictions[1] = 2;
+  tests_lens[1] = 2;
+
+  // b is used again before c comes in, so a is the one evicted.
+  const char *t3[] = {"a", "b", "b", "c", "b", NULL};
+  memcpy(tests_patterns[2], t3, sizeof(t3));
+  tests_capacities[2] = 2;
+  tests_hits[2] = 2;
+  tests_misses[2] = 3;
+  tests_evictions[2] = 1;
+  tests_lens[2] = 2;
+
+  const char *t4[] = {"(a|b)*", "(a|b)*", NULL};
+  memcpy(tests_patterns[3], t4, sizeof(t4));
+  tests_capacities[3] = 0;
+  tests_misses[3] = 2;
+
+  // shrinking keeps the most recently used pattern, which then hits.
+  const char *t5[] = {"a", "b", "c", "c", NULL};
+  memcpy(tests_patterns[4], t5, sizeof(t5));
+  tests_capacities[4] = 3;
+  tests_shrink_to[4] = 1;
+  tests_hits[4] = 1;
+  tests_misses[4] = 3;
+  tests_evictions[4] = 2;
+  tests_lens[4] = 1;
+
+  // invalid patterns are never cached.
+  const char *t6[] = {"a(", "a(", NULL};
+  memcpy(tests_patterns[5], t6, sizeof(t6));
+  tests_capacities[5] = 2;
+  tests_misses[5] = 2;
+
+  for (int i = 0; i < 20; i++) {
+    if (tests_patterns[i][0] == NULL) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_cache(tests_capacities[i], tests_patterns[i],
+                       tests_shrink_to[i], tests_hits[i], tests_misses[i],
+                       tests_evictions[i], tests_lens[i]);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  // the global cache, callers holding one pattern at once, and a regex
+  // evicted while a caller still holds it.
+  for (int k = 0; k < 3; k++) {
+    total++;
+    printf("T%i Testing...\n", total);
+
+    int t;
+
+    if (k == 0)
+      t = test_global_cache();
+    else if (k == 1)
+      t = test_shared_entries();
+    else
+      t = test_evict_held();
+
+    if (t == 1) {
+      printf("T%i is successful\n", total);
+      success++;
+      tests[total - 1] = 1;
+    } else {
+      printf("T%i has failed\n", total);
+      tests[total - 1] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing regex caches\n\n");
+}
+
+// every pattern is acquired, matched and released in turn. the cache is
+// shrunk to shrink_to before the last pattern, unless it is -1.
+int test_cache(int capacity, const char **patterns, int shrink_to,
+               int expected_hits, int expected_misses,
+               int expected_evictions, int expected_len) {
+  printf("Testing a cache of %i regexes...\n", capacity);
+
+  regex_cache *c = new_regex_cache(capacity);
+
+  if (c == NULL)
+    return 0;
+
+  int val = 1;
+
+  for (int i = 0; patterns[i] != NULL; i++) {
+    if (shrink_to != -1 && patterns[i + 1] == NULL &&
+        regex_cache_set_capacity(c, shrink_to) == -1)
+      val = 0;
+
+    int err;
+    const regex *r = regex_cache_acquire(c, patterns[i], &err);
+
+    if (r == NULL) {
+      if (err == REGEX_OK)
+        val = 0;
+
+      continue;
+    }
+
+    if (strcmp(r->pattern, patterns[i]) != 0 || regex_match(r, "ab", 2) < 0)
+      val = 0;
+
+    regex_cache_release(c, r);
+  }
+
+  regex_cache_stats stats;
+  regex_cache_get_stats(c, &stats);
+
+  printf("%zu hits, %zu misses, %zu evictions, %i cached\n", stats.hits,
+         stats.misses, stats.evictions, stats.len);
+
+  if (stats.hits != (size_t)expected_hits ||
+      stats.misses != (size_t)expected_misses ||
+      stats.evictions != (size_t)expected_evictions ||
+      stats.len != expected_len)
+    val = 0;
+
+  free_regex_cache(c);
+  return val;
+}
+
+// evaluate_string compiles a pattern once and hits the cache after that.
+int test_global_cache() {
+  printf("Testing the global cache through evaluate_string...\n");
+
+  regex_cache_stats before;
+  regex_cache_stats after;
+  regex_cache_get_stats(regex_cache_global(), &before);
+
+  int val = evaluate_string("aab", "a*b", 0) == 1 &&
+            evaluate_string("ba", "a*b", 0) == 0 &&
+            evaluate_string("b", "a*b", 0) == 1;
+
+  regex_cache_get_stats(regex_cache_global(), &after);
+
+  printf("%zu hits, %zu misses\n", after.hits - before.hits,
+         after.misses - before.misses);
+
+  return val && after.hits - before.hits == 2 &&
+         after.misses - before.misses == 1;
+}
+
+// callers acquiring a pattern while another one holds it all hit the same
+// regex, which stays cached after the last of them gives it back.
+int test_shared_entries() {
+  printf("Testing callers sharing a cached regex...\n");
+
+  regex_cache *c = new_regex_cache(2);
+
+  if (c == NULL)
+    return 0;
+
+  const regex *first = regex_cache_acquire(c, "a*b", NULL);
+  const regex *second = regex_cache_acquire(c, "a*b", NULL);
+  const regex *third = regex_cache_acquire(c, "a*b", NULL);
+
+  int val = first != NULL && first == second && second == third &&
+            regex_match(second, "aab", 3) == 1;
+
+  regex_cache_release(c, first);
+  regex_cache_release(c, third);
+  regex_cache_release(c, second);
+
+  regex_cache_stats stats;
+  regex_cache_get_stats(c, &stats);
+
+  if (stats.hits != 2 || stats.misses != 1 || stats.len != 1)
+    val = 0;
+
+  free_regex_cache(c);
+  return val;
+}
+
+// an evicted regex stays usable until its holder gives it back, and a
+// pattern acquired again after that compiles anew.
+int test_evict_held() {
+  printf("Testing a cached regex evicted while held...\n");
+
+  regex_cache *c = new_regex_cache(1);
+
+  if (c == NULL)
+    return 0;
+
+  const regex *held = regex_cache_acquire(c, "a*b", NULL);
+  const regex *other = regex_cache_acquire(c, "ba", NULL);
+
+  int val = held != NULL && other != NULL && regex_match(held, "ab", 2) == 1 &&
+            regex_match(other, "ba", 2) == 1;
+
+  regex_cache_release(c, other);
+  regex_cache_release(c, held);
+
+  const regex *again = regex_cache_acquire(c, "a*b", NULL);
+
+  if (again == NULL || regex_match(again, "b", 1) != 1)
+    val = 0;
+
+  regex_cache_release(c, again);
+
+  regex_cache_stats stats;
+  regex_cache_get_stats(c, &stats);
+
+  if (stats.hits != 0 || stats.misses != 3 || stats.evictions != 2 ||
+      stats.len != 1)
+    val = 0;
+
+  free_regex_cache(c);
+  return val;
+}
@@ -0,0 +1,174 @@
+#include "../src/codegen.h"
+#include <unistd.h>
+
+int test_codegen(const char **patterns, const char **strs,
+                 int expected_failed);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing generated matchers...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *tests_patterns[20][8];
+  int tests_failed[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_patterns[i][0] = NULL;
+    tests_failed[i] = -1;
+  }
+
+  const char *strs[] = {"",      "a",     "b",        "ab",       "abab",
+                        "aab",   "abba",  "baab",     "aaaaaaab", "abcdef",
+                        "abcdf", "01234", "abcdedef", "a b",      "ababa",
+                        "bbbb",  "aabab", "babab",    NULL};
+
+  const char *t1[] = {"a*b", NULL};
+  memcpy(tests_patterns[0], t1, sizeof(t1));
+
+  const char *t2[] = {"ab(ab)*", "(a|b)*a(a|b)a(a|b)b", "(ab|ba)*(a|bb)*",
+                      "abc(d|e)*f", "", "(0|1|2|3|4)*", NULL};
+  memcpy(tests_patterns[1], t2, sizeof(t2));
+
+  // the second pattern does not compile, so nothing is generated for it.
+  const char *t3[] = {"a", "a(", NULL};
+  memcpy(tests_patterns[2], t3, sizeof(t3));
+  tests_failed[2] = 1;
+
+  for (int i = 0; i < 20; i++) {
+    if (tests_patterns[i][0] == NULL) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_codegen(tests_patterns[i], strs, tests_failed[i]);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing generated matchers\n\n");
+}
+
+// the matchers are written with a main that runs every one of them on every
+// string, which is compiled with warnings as errors and run, and its output
+// is compared with regex_match.
+int test_codegen(const char **patterns, const char **strs,
+                 int expected_failed) {
+  int count = 0;
+  int strs_len = 0;
+
+  while (patterns[count] != NULL)
+    count++;
+
+  while (strs[strs_len] != NULL)
+    strs_len++;
+
+  printf("Testing %i generated matchers...\n", count);
+
+  char path[] = "/tmp/codegen_testXXXXXX";
+  int fd = mkstemp(path);
+
+  if (fd == -1)
+    return 0;
+
+  close(fd);
+
+  char source[64];
+  snprintf(source, sizeof(source), "%s.c", path);
+
+  FILE *out = fopen(source, "w");
+  char names[8][24];
+  const char *name_ptrs[8];
+
+  for (int i = 0; i < count; i++) {
+    snprintf(names[i], sizeof(names[i]), "match_%i", i);
+    name_ptrs[i] = names[i];
+  }
+
+  int failed;
+  int written =
+      write_regex_matchers(out, name_ptrs, patterns, count, NULL, &failed);
+
+  if (expected_failed != -1) {
+    fclose(out);
+    remove(source);
+    remove(path);
+    return written == -1 && failed == expected_failed;
+  }
+
+  fprintf(out, "\n#include <stdio.h>\n#include <string.h>\n\n");
+  fprintf(out, "int main() {\n  const char *strs[] = {");
+
+  for (int k = 0; k < strs_len; k++)
+    fprintf(out, "\"%s\", ", strs[k]);
+
+  fprintf(out, "};\n\n  for (int k = 0; k < %i; k++) {\n", strs_len);
+
+  for (int i = 0; i < count; i++)
+    fprintf(out, "    printf(\"%%i\", match_%i(strs[k], strlen(strs[k])));\n",
+            i);
+
+  fprintf(out, "  }\n\n  return 0;\n}\n");
+  fclose(out);
+
+  char command[256];
+  snprintf(command, sizeof(command), "g++ -O2 -Wall -Werror -o %s %s", path,
+           source);
+
+  int val = written == 0 && system(command) == 0;
+  FILE *run = val ? popen(path, "r") : NULL;
+
+  for (int k = 0; k < strs_len && run != NULL && val; k++) {
+    for (int i = 0; i < count && val; i++) {
+      regex *r = regex_compile(patterns[i]);
+      int expected = regex_match(r, strs[k], strlen(strs[k]));
+
+      if (fgetc(run) != '0' + expected) {
+        printf("'%s' on '%s' did not give %i\n", patterns[i], strs[k],
+               expected);
+        val = 0;
+      }
+
+      regex_free(r);
+    }
+  }
+
+  if (run != NULL && pclose(run) != 0)
+    val = 0;
+
+  remove(source);
+  remove(path);
+  return val;
+}
@@ -0,0 +1,295 @@
+#include "../src/regex.h"
+#include <pthread.h>
+
+#define SHARED_THREADS 8
+
+typedef struct shared_match {
+  const regex *r;
+  int failed;
+  pthread_t thread;
+} shared_match;
+
+int test_context(const char *str, const char *regex, size_t cache_size,
+                 int search);
+int test_shared_regex();
+int test_context_reuse();
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing match contexts...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *tests_string_inputs[20];
+  const char *tests_regex_inputs[20];
+  size_t tests_cache_sizes[20];
+  int tests_searches[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_string_inputs[i] = NULL;
+    tests_regex_inputs[i] = "";
+    tests_cache_sizes[i] = 0;
+    tests_searches[i] = 0;
+  }
+
+  tests_string_inputs[0] = "abababab";
+  tests_regex_inputs[0] = "(ab)*";
+
+  // a cache this small keeps flushing until the lazy dfa gives up, so the
+  // match goes on in the nfa simulation.
+  tests_string_inputs[1] =
+      "aabbaabbaabbbaaabaaaababbbbbbabaaababbbbbbbabababaabbaabbababaabbbaaab"
+      "bbaabaaaaabbbaabbbabbbbabbabbbbbabbabaabbbbbbaaabb";
+  tests_regex_inputs[1] = "(a|b)*a(a|b)a(a|b)b";
+  tests_cache_sizes[1] = 64;
+
+  tests_string_inputs[2] = "xxmdmmnbnq";
+  tests_regex_inputs[2] = "a|(bc|df)*mdm*(nbn)*|d*wd*";
+  tests_searches[2] = 1;
+
+  tests_string_inputs[3] = "bbbbbbbbbbabbbbbbbbbbbbbabbbbbbbbbbbbbbbbabb";
+  tests_regex_inputs[3] = "a(a|b)b(a|b)*b";
+  tests_cache_sizes[3] = 64;
+  tests_searches[3] = 1;
+
+  for (int i = 0; i < 20; i++) {
+    if (tests_string_inputs[i] == NULL) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_context(tests_string_inputs[i], tests_regex_inputs[i],
+                         tests_cache_sizes[i], tests_searches[i]);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  // one regex matched from many threads at once, and the pool handing
+  // back the context given back last.
+  for (int k = 0; k < 2; k++) {
+    total++;
+    printf("T%i Testing...\n", total);
+
+    int t = k == 0 ? test_shared_regex() : test_context_reuse();
+
+    if (t == 1) {
+      printf("T%i is successful\n", total);
+      success++;
+      tests[total - 1] = 1;
+    } else {
+      printf("T%i has failed\n", total);
+      tests[total - 1] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing match contexts\n\n");
+}
+
+static int context_heap_allocations(const regex_match_context *c) {
+  int heap_allocations = c->mem->heap_allocations;
+
+  if (c->lazy != NULL)
+    heap_allocations += c->lazy->mem->heap_allocations;
+
+  if (c->search != NULL)
+    heap_allocations += c->search->mem->heap_allocations;
+
+  return heap_allocations;
+}
+
+// a second context has to give the regex's own answers, and once a search
+// has built its unanchored dfa, no match or search with either of them may
+// touch the heap again.
+int test_context(const char *str, const char *regex, size_t cache_size,
+                 int search) {
+  printf("Testing string '%s' with regex '%s'...\n", str, regex);
+
+  regex_options options;
+  options.dfa_cache_size = cache_size;
+  options.full_dfa = 0;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = 1;
+
+  struct regex *r = regex_compile_with_options(regex, &options, NULL);
+
+  if (r == NULL)
+    return 0;
+
+  regex_match_context *c = new_regex_match_context(r);
+
+  if (c == NULL) {
+    regex_free(r);
+    return 0;
+  }
+
+  int len = strlen(str);
+  int val = 1;
+
+  for (int i = 0; i < 3 && val; i++) {
+    int heap_allocations = context_heap_allocations(c);
+    int expected;
+    int got;
+
+    if (search) {
+      int start = -1;
+      int end = -1;
+      int c_start = -1;
+      int c_end = -1;
+
+      expected = regex_search(r, str, len, &start, &end);
+      got = regex_search_with(c, str, len, &c_start, &c_end);
+      val = expected == got && start == c_start && end == c_end;
+    } else {
+      expected = regex_match(r, str, len);
+      got = regex_match_with(c, str, len);
+      val = expected == got;
+    }
+
+    regex_alloc_stats stats;
+    regex_get_alloc_stats(r, &stats);
+
+    if (expected == -1)
+      val = 0;
+
+    if ((i > 0 || !search) && (stats.match_heap_allocations != 0 ||
+                               context_heap_allocations(c) != heap_allocations))
+      val = 0;
+  }
+
+  free_regex_match_context(c);
+  regex_free(r);
+  return val;
+}
+
+static void *run_shared_match(void *arg) {
+  shared_match *m = (shared_match *)arg;
+  char str[64];
+
+  for (int i = 0; i < 2000 && !m->failed; i++) {
+    int len = i % 60;
+
+    // a string of b with an a at i % 7, which matches when the a is third
+    // from the end.
+    memset(str, 'b', len);
+
+    if (i % 7 < len)
+      str[i % 7] = 'a';
+
+    int expected = len >= 3 && i % 7 == len - 3;
+    int start;
+    int end;
+
+    if (regex_match(m->r, str, len) != expected ||
+        regex_search(m->r, str, len, &start, &end) != (i % 7 < len - 2))
+      m->failed = 1;
+  }
+
+  return NULL;
+}
+
+// every thread matches and searches with the same regex, which can only
+// have made as many contexts as there were threads running at once.
+int test_shared_regex() {
+  printf("Testing a regex shared by %i threads...\n", SHARED_THREADS);
+
+  regex_options options;
+  options.dfa_cache_size = 0;
+  options.full_dfa = 0;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = 1;
+
+  struct regex *r = regex_compile_with_options("(a|b)*a(a|b)(a|b)", &options,
+                                               NULL);
+
+  if (r == NULL)
+    return 0;
+
+  shared_match matches[SHARED_THREADS];
+  int started = 0;
+  int val = 1;
+
+  for (; started < SHARED_THREADS; started++) {
+    matches[started].r = r;
+    matches[started].failed = 0;
+
+    if (pthread_create(&matches[started].thread, NULL, run_shared_match,
+                       &matches[started]) != 0)
+      break;
+  }
+
+  for (int i = 0; i < started; i++) {
+    pthread_join(matches[i].thread, NULL);
+
+    if (matches[i].failed)
+      val = 0;
+  }
+
+  if (started == 0 || r->runtime->pool.slots_used > started + 1)
+    val = 0;
+
+  regex_free(r);
+  return val;
+}
+
+// a context given back is the next one borrowed, contexts borrowed at once
+// are different ones, and a regex matched from one thread only ever has the
+// context it made when it was compiled.
+int test_context_reuse() {
+  printf("Testing the reuse of pooled contexts...\n");
+
+  struct regex *r = regex_compile("ab*");
+
+  if (r == NULL)
+    return 0;
+
+  regex_match_context *first = regex_borrow_context(r);
+  regex_match_context *second = regex_borrow_context(r);
+  int val = first != NULL && second != NULL && first != second;
+
+  regex_return_context(r, second);
+  regex_return_context(r, first);
+
+  if (regex_borrow_context(r) != first || regex_borrow_context(r) != second)
+    val = 0;
+
+  regex_return_context(r, first);
+  regex_return_context(r, second);
+
+  if (regex_match(r, "abbb", 4) != 1 || r->runtime->pool.slots_used != 2)
+    val = 0;
+
+  regex_free(r);
+  return val;
+}
@@ -0,0 +1,269 @@
+#include "../src/dfa_file.h"
+#include <unistd.h>
+
+int test_dfa_file(const char **patterns, const char **strs,
+                  int expected_failed, int corrupt_at);
+int test_corrupt_tables(int byte_classes);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing dfa files...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *tests_patterns[20][8];
+  int tests_failed[20];
+  int tests_corrupt_at[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_patterns[i][0] = NULL;
+    tests_failed[i] = -1;
+    tests_corrupt_at[i] = -1;
+  }
+
+  const char *strs[] = {"", "a", "b", "ab", "aab", "abab", "abba", "baab",
+                        "aaaaaaab", "abcdef", "abcdedef", "01234", "a b",
+                        NULL};
+
+  const char *t1[] = {"a*b", NULL};
+  memcpy(tests_patterns[0], t1, sizeof(t1));
+
+  const char *t2[] = {"(a|b)*a(a|b)a(a|b)b", "(ab|ba)*(a|bb)*", "abc(d|e)*f",
+                      "", "(0|1|2|3|4)*", NULL};
+  memcpy(tests_patterns[1], t2, sizeof(t2));
+
+  // the third pattern does not compile, so no file is written.
+  const char *t3[] = {"a", "b", "a(", NULL};
+  memcpy(tests_patterns[2], t3, sizeof(t3));
+  tests_failed[2] = 2;
+
+  // a file of another version, and one cut short, are refused.
+  const char *t4[] = {"a*b", "abc", NULL};
+  memcpy(tests_patterns[3], t4, sizeof(t4));
+  tests_corrupt_at[3] = 8;
+
+  const char *t5[] = {"a*b", "abc", NULL};
+  memcpy(tests_patterns[4], t5, sizeof(t5));
+  tests_corrupt_at[4] = 0;
+
+  for (int i = 0; i < 20; i++) {
+    if (tests_patterns[i][0] == NULL) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_dfa_file(tests_patterns[i], strs, tests_failed[i],
+                          tests_corrupt_at[i]);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  // a byte class past the last column is refused when the file is opened,
+  // and a transition to a state past the last one when it is used.
+  for (int k = 0; k < 2; k++) {
+    total++;
+    printf("T%i Testing...\n", total);
+
+    if (test_corrupt_tables(k) == 1) {
+      printf("T%i is successful\n", total);
+      success++;
+      tests[total - 1] = 1;
+    } else {
+      printf("T%i has failed\n", total);
+      tests[total - 1] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing dfa files\n\n");
+}
+
+// corrupt_at is the offset of a byte that is changed after writing the file,
+// or 0 to truncate it, after which opening it has to fail.
+int test_dfa_file(const char **patterns, const char **strs,
+                  int expected_failed, int corrupt_at) {
+  int count = 0;
+
+  while (patterns[count] != NULL)
+    count++;
+
+  printf("Testing a dfa file of %i patterns...\n", count);
+
+  char path[] = "/tmp/dfa_file_testXXXXXX";
+  int fd = mkstemp(path);
+
+  if (fd == -1)
+    return 0;
+
+  close(fd);
+
+  int failed;
+  int written = write_dfa_file(path, patterns, count, NULL, &failed);
+
+  if (expected_failed != -1) {
+    remove(path);
+    return written == -1 && failed == expected_failed;
+  }
+
+  if (written == -1) {
+    remove(path);
+    return 0;
+  }
+
+  if (corrupt_at != -1) {
+    if (corrupt_at == 0) {
+      if (truncate(path, sizeof(dfa_file_header) + 8) == -1)
+        return 0;
+    } else {
+      FILE *f = fopen(path, "r+b");
+      fseek(f, corrupt_at, SEEK_SET);
+      fputc(0x7f, f);
+      fclose(f);
+    }
+
+    dfa_file *f = open_dfa_file(path);
+    remove(path);
+
+    if (f != NULL) {
+      close_dfa_file(f);
+      return 0;
+    }
+
+    return 1;
+  }
+
+  dfa_file *f = open_dfa_file(path);
+  remove(path);
+
+  if (f == NULL || f->count != count) {
+    close_dfa_file(f);
+    return 0;
+  }
+
+  int val = 1;
+
+  for (int i = 0; i < count && val; i++) {
+    regex *r = regex_compile(patterns[i]);
+    dfa d;
+
+    if (r == NULL || strcmp(dfa_file_pattern(f, i), patterns[i]) != 0 ||
+        dfa_file_get(f, i, &d) == -1)
+      val = 0;
+
+    for (int k = 0; strs[k] != NULL && val; k++) {
+      int len = strlen(strs[k]);
+      int expected = regex_match(r, strs[k], len);
+
+      if (dfa_file_match(f, i, strs[k], len) != expected ||
+          dfa_match(&d, strs[k], len) != expected)
+        val = 0;
+    }
+
+    regex_free(r);
+  }
+
+  printf("%i patterns in a %zu byte file\n", f->count, f->size);
+
+  close_dfa_file(f);
+  return val;
+}
+
+// the file is written and opened once to find where the tables of its only
+// entry are, and then one value in them is put out of range. the corrupted
+// transition is the one init takes on 'a'.
+int test_corrupt_tables(int byte_classes) {
+  printf("Testing a dfa file with a corrupted %s...\n",
+         byte_classes ? "byte class" : "transition");
+
+  char path[] = "/tmp/dfa_file_testXXXXXX";
+  int fd = mkstemp(path);
+
+  if (fd == -1)
+    return 0;
+
+  close(fd);
+
+  const char *patterns[] = {"a*b"};
+  dfa_file *f = NULL;
+
+  if (write_dfa_file(path, patterns, 1, NULL, NULL) != -1)
+    f = open_dfa_file(path);
+
+  if (f == NULL) {
+    remove(path);
+    return 0;
+  }
+
+  const dfa_file_entry *e = &f->entries[0];
+  long at;
+  int value;
+
+  if (byte_classes) {
+    at = (const unsigned char *)e->byte_classes + 'b' - f->base;
+    value = e->number_of_classes;
+  } else {
+    at = e->transitions_offset +
+         sizeof(int) * ((long)e->init * e->number_of_classes +
+                        e->byte_classes['a']);
+    value = e->number_of_states;
+  }
+
+  close_dfa_file(f);
+
+  FILE *out = fopen(path, "r+b");
+  fseek(out, at, SEEK_SET);
+
+  if (byte_classes)
+    fputc(value, out);
+  else
+    fwrite(&value, sizeof(value), 1, out);
+
+  fclose(out);
+
+  f = open_dfa_file(path);
+  remove(path);
+
+  if (byte_classes) {
+    close_dfa_file(f);
+    return f == NULL;
+  }
+
+  dfa d;
+  int val = f != NULL && dfa_file_match(f, 0, "b", 1) == 1 &&
+            dfa_file_match(f, 0, "ab", 2) == -1 &&
+            dfa_file_get(f, 0, &d) == -1 && dfa_file_get(f, 0, &d) == -1;
+
+  close_dfa_file(f);
+  return val;
+}
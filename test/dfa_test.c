@@ -0,0 +1,231 @@
+#include "../src/regex.h"
+
+int test_dfa(const char *str, const char *regex, size_t cache_size,
+             int full_dfa);
+int test_dfa_state_limit(const char *regex, int limit, int expected_err);
+int test_dfa_classes(const char *regex, int expected_classes);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing dfa...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *tests_string_inputs[20];
+  const char *tests_regex_inputs[20];
+  size_t tests_cache_sizes[20];
+  int tests_full_dfas[20];
+  int tests_expected_returns[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_string_inputs[i] = "";
+    tests_regex_inputs[i] = "";
+    tests_cache_sizes[i] = 0;
+    tests_full_dfas[i] = 0;
+    tests_expected_returns[i] = 1;
+  }
+
+  tests_string_inputs[0] = "abababab";
+  tests_regex_inputs[0] = "(ab)*";
+  tests_expected_returns[0] = 1;
+
+  tests_string_inputs[1] = "bcbcbcmdnbnnbn";
+  tests_regex_inputs[1] = "a|(bc|df)*mdm*(nbn)*|d*wd*";
+  tests_expected_returns[1] = 1;
+
+  tests_string_inputs[2] = "bcbcdmdnbn";
+  tests_regex_inputs[2] = "a|(bc|df)*mdm*(nbn)*|d*wd*";
+  tests_expected_returns[2] = 0;
+
+  // a cache that only fits a few states has to be flushed while matching,
+  // and has to give the same answers.
+  tests_string_inputs[3] = "abbabaababbbabaabbbabaab";
+  tests_regex_inputs[3] = "(a|b)*a(a|b)a(a|b)b";
+  tests_cache_sizes[3] = 1;
+  tests_expected_returns[3] = 1;
+
+  tests_string_inputs[4] = "abbabaababbbabaabbbabbab";
+  tests_regex_inputs[4] = "(a|b)*a(a|b)a(a|b)b";
+  tests_cache_sizes[4] = 1;
+  tests_expected_returns[4] = 0;
+
+  tests_string_inputs[5] = "abbabaababbbabaabbbabaab";
+  tests_regex_inputs[5] = "(a|b)*a(a|b)a(a|b)b";
+  tests_expected_returns[5] = 1;
+
+  tests_string_inputs[6] = "abbabaababbbabaabbbabaab";
+  tests_regex_inputs[6] = "(a|b)*a(a|b)a(a|b)b";
+  tests_full_dfas[6] = 1;
+  tests_expected_returns[6] = 1;
+
+  tests_string_inputs[7] = "abbabaababbbabaabbbabbab";
+  tests_regex_inputs[7] = "(a|b)*a(a|b)a(a|b)b";
+  tests_full_dfas[7] = 1;
+  tests_expected_returns[7] = 0;
+
+  tests_string_inputs[8] = "bcbcbcmdnbnnbn";
+  tests_regex_inputs[8] = "a|(bc|df)*mdm*(nbn)*|d*wd*";
+  tests_full_dfas[8] = 1;
+  tests_expected_returns[8] = 1;
+
+  tests_string_inputs[9] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab";
+  tests_regex_inputs[9] = "((a*)*)*b";
+  tests_full_dfas[9] = 1;
+  tests_expected_returns[9] = 1;
+
+  for (int i = 0; i < 20; i++) {
+    if (strlen(tests_regex_inputs[i]) == 0 ||
+        strlen(tests_string_inputs[i]) == 0) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_dfa(tests_string_inputs[i], tests_regex_inputs[i],
+                     tests_cache_sizes[i], tests_full_dfas[i]);
+
+    if (t == tests_expected_returns[i]) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  // the dfa of (a|b)*a(a|b)a(a|b)b has to remember the last five characters
+  // it has seen, so the subset construction goes past eight states.
+  printf("T%i Testing...\n", 20 + 1);
+  total++;
+
+  if (test_dfa_state_limit("(a|b)*a(a|b)a(a|b)b", 8,
+                           REGEX_ERR_TOO_MANY_STATES) &&
+      test_dfa_state_limit("(a|b)*a(a|b)a(a|b)b", 64, REGEX_OK)) {
+    printf("T%i is successful\n", 20 + 1);
+    success++;
+  } else {
+    printf("T%i has failed\n", 20 + 1);
+  }
+
+  // every byte no transition reads shares class 0, so the table of
+  // (ab)*|(ba)* only has a column for a, one for b and one for the rest.
+  printf("T%i Testing...\n", 20 + 2);
+  total++;
+
+  if (test_dfa_classes("(ab)*|(ba)*", 3) &&
+      test_dfa_classes("a|(bc|df)*mdm*(nbn)*|d*wd*", 9)) {
+    printf("T%i is successful\n", 20 + 2);
+    success++;
+  } else {
+    printf("T%i has failed\n", 20 + 2);
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing dfa\n\n");
+}
+
+int test_dfa(const char *str, const char *regex, size_t cache_size,
+             int full_dfa) {
+  printf("Testing string '%s' with regex '%s' and a %s...\n", str, regex,
+         full_dfa ? "full dfa" : cache_size > 0 ? "tiny cache" : "lazy dfa");
+
+  regex_options options;
+  options.dfa_cache_size = cache_size;
+  options.full_dfa = full_dfa;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = 1;
+
+  struct regex *r = regex_compile_with_options(regex, &options, NULL);
+
+  if (r == NULL)
+    return -1;
+
+  int val = regex_match(r, str, strlen(str));
+  regex_match_context *c = regex_borrow_context(r);
+
+  // the nfa simulation is the reference the dfa has to agree with
+  if (c == NULL ||
+      evaluate_string_in_nfa_with(r->n, c->nfa, str, strlen(str)) != val)
+    val = -1;
+
+  regex_return_context(r, c);
+
+  // the second run goes through the transitions cached by the first one
+  if (regex_match(r, str, strlen(str)) != val)
+    val = -1;
+
+  regex_free(r);
+  return val;
+}
+
+int test_dfa_state_limit(const char *regex, int limit, int expected_err) {
+  printf("Testing regex '%s' with a limit of %i dfa states...\n", regex,
+         limit);
+
+  regex_options options;
+  options.dfa_cache_size = 0;
+  options.full_dfa = 1;
+  options.dfa_state_limit = limit;
+  options.no_bit_parallel = 0;
+
+  int err;
+  struct regex *r = regex_compile_with_options(regex, &options, &err);
+
+  if (r != NULL) {
+    printf("Minimized dfa has %i states\n", regex_dfa_state_count(r));
+    regex_free(r);
+  }
+
+  return err == expected_err;
+}
+
+int test_dfa_classes(const char *regex, int expected_classes) {
+  printf("Testing regex '%s' for %i byte classes...\n", regex,
+         expected_classes);
+
+  regex_options options;
+  options.dfa_cache_size = 0;
+  options.full_dfa = 1;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = 0;
+
+  struct regex *r = regex_compile_with_options(regex, &options, NULL);
+
+  if (r == NULL)
+    return 0;
+
+  regex_match_context *c = regex_borrow_context(r);
+  int val = c != NULL && c->lazy == NULL &&
+            r->full->number_of_classes == expected_classes &&
+            r->n->byte_classes['-'] == 0 &&
+            r->n->byte_classes['a'] != r->n->byte_classes['b'];
+
+  regex_return_context(r, c);
+
+  regex_free(r);
+  return val;
+}
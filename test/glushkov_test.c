@@ -0,0 +1,153 @@
+#include "../src/regex.h"
+
+int test_glushkov(const char *str, const char *regex, int expected_words);
+char *repeat(const char *s, int times);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing glushkov...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  char *long_regex = repeat("(ab|c)*d", 30);
+  char *long_string = repeat("ababccd", 30);
+  char *longer_regex = repeat("(ab|c)*d", 100);
+
+  const char *tests_string_inputs[20];
+  const char *tests_regex_inputs[20];
+  int tests_expected_words[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_string_inputs[i] = "";
+    tests_regex_inputs[i] = "";
+    tests_expected_words[i] = 1;
+  }
+
+  tests_string_inputs[0] = "abbaab";
+  tests_regex_inputs[0] = "(ab*)*";
+
+  tests_string_inputs[1] = "b";
+  tests_regex_inputs[1] = "(ab*)*";
+
+  tests_string_inputs[2] = "bcbcbcmdnbnnbn";
+  tests_regex_inputs[2] = "a|(bc|df)*mdm*(nbn)*|d*wd*";
+
+  tests_string_inputs[3] = "abbabaababbbabaabbbabaab";
+  tests_regex_inputs[3] = "(a|b)*a(a|b)a(a|b)b";
+
+  tests_string_inputs[4] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab";
+  tests_regex_inputs[4] = "((a*)*)*b";
+
+  // 120 symbols take two words of states, which regex_compile leaves to the
+  // lazy dfa but which can still be built directly.
+  tests_string_inputs[5] = long_string;
+  tests_regex_inputs[5] = long_regex;
+  tests_expected_words[5] = 2;
+
+  tests_string_inputs[6] = "ababccdababccd";
+  tests_regex_inputs[6] = long_regex;
+  tests_expected_words[6] = 2;
+
+  // too many symbols for the glushkov engine, the lazy dfa matches instead.
+  tests_string_inputs[7] = long_string;
+  tests_regex_inputs[7] = longer_regex;
+  tests_expected_words[7] = 0;
+
+  for (int i = 0; i < 20; i++) {
+    if (strlen(tests_regex_inputs[i]) == 0 ||
+        strlen(tests_string_inputs[i]) == 0) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_glushkov(tests_string_inputs[i], tests_regex_inputs[i],
+                          tests_expected_words[i]);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  free(long_regex);
+  free(long_string);
+  free(longer_regex);
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing glushkov\n\n");
+}
+
+int test_glushkov(const char *str, const char *regex, int expected_words) {
+  printf("Testing a string of %i bytes with a regex of %i bytes...\n",
+         (int)strlen(str), (int)strlen(regex));
+
+  struct regex *r = regex_compile(regex);
+
+  if (r == NULL)
+    return 0;
+
+  glushkov *g = new_glushkov_from_regex(r->postfix, strlen(r->postfix), NULL);
+  int words = g != NULL ? g->words : 0;
+  int val = regex_match(r, str, strlen(str));
+
+  // the nfa simulation is the reference the glushkov engine has to agree
+  // with, on the whole string and on every prefix of it.
+  regex_match_context *c = regex_borrow_context(r);
+  int agrees = c != NULL && words == expected_words &&
+               (r->bits != NULL) == (words == 1);
+
+  for (int len = strlen(str); len >= 0 && agrees; len--) {
+    int expected = evaluate_string_in_nfa_with(r->n, c->nfa, str, len);
+
+    if (regex_match(r, str, len) != expected ||
+        (g != NULL && glushkov_match(g, str, len) != expected))
+      agrees = 0;
+  }
+
+  regex_return_context(r, c);
+  if (g != NULL)
+    free_glushkov(g);
+
+  regex_free(r);
+  return agrees && val != -1;
+}
+
+char *repeat(const char *s, int times) {
+  int len = strlen(s);
+  char *repeated = (char *)malloc(len * times + 1);
+
+  for (int i = 0; i < times; i++)
+    memcpy(repeated + i * len, s, len);
+
+  repeated[len * times] = '\0';
+
+  return repeated;
+}
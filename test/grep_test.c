@@ -0,0 +1,268 @@
+#include "../src/grep.h"
+#include <unistd.h>
+
+int test_grep(const char *buf, size_t len, const char *regex, int count,
+              int threads, const char *expected);
+int test_chunked_grep();
+int test_grep_file(const char *buf, const char *regex, const char *expected);
+int test_find_newline();
+
+char *new_lines(size_t len);
+char *expected_lines(const char *buf, size_t len, const char *regex);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing grep...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *tests_buffer_inputs[20];
+  const char *tests_regex_inputs[20];
+  const char *tests_expected[20];
+  int tests_counts[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_buffer_inputs[i] = NULL;
+    tests_regex_inputs[i] = "";
+    tests_expected[i] = NULL;
+    tests_counts[i] = 0;
+  }
+
+  tests_buffer_inputs[0] = "xxab\nfoo\nabab\n\nba\nzz";
+  tests_regex_inputs[0] = "ab(ab)*";
+  tests_expected[0] = "xxab\nabab\n";
+
+  tests_buffer_inputs[1] = "a\nb\na";
+  tests_regex_inputs[1] = "a";
+  tests_expected[1] = "2\n";
+  tests_counts[1] = 1;
+
+  // the empty pattern is found in every line, the empty one too, but the
+  // last newline does not start another line.
+  tests_buffer_inputs[2] = "a\n\nb\n";
+  tests_regex_inputs[2] = "";
+  tests_expected[2] = "a\n\nb\n";
+
+  tests_buffer_inputs[3] = "";
+  tests_regex_inputs[3] = "a";
+  tests_expected[3] = "0\n";
+  tests_counts[3] = 1;
+
+  tests_buffer_inputs[4] = "one\ntwo\nthree\n";
+  tests_regex_inputs[4] = "x|y|z";
+  tests_expected[4] = "";
+
+  for (int i = 0; i < 20; i++) {
+    if (tests_buffer_inputs[i] == NULL) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_grep(tests_buffer_inputs[i], strlen(tests_buffer_inputs[i]),
+                      tests_regex_inputs[i], tests_counts[i], 0,
+                      tests_expected[i]);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  // a buffer of many chunks, a mapped file and the newline search.
+  for (int k = 0; k < 3; k++) {
+    total++;
+    printf("T%i Testing...\n", total);
+
+    int t;
+
+    if (k == 0)
+      t = test_chunked_grep();
+    else if (k == 1)
+      t = test_grep_file("ab\nba\nab", "a", "ab\nba\nab\n");
+    else
+      t = test_find_newline();
+
+    if (t == 1) {
+      printf("T%i is successful\n", total);
+      success++;
+      tests[total - 1] = 1;
+    } else {
+      printf("T%i has failed\n", total);
+      tests[total - 1] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing grep\n\n");
+}
+
+int test_grep(const char *buf, size_t len, const char *regex, int count,
+              int threads, const char *expected) {
+  printf("Testing '%s' on %zu bytes...\n", regex, len);
+
+  struct regex *r = regex_compile(regex);
+
+  if (r == NULL)
+    return 0;
+
+  char *output = NULL;
+  size_t output_len = 0;
+  FILE *out = open_memstream(&output, &output_len);
+
+  grep_options options;
+  options.count = count;
+  options.with_names = 0;
+  options.threads = threads;
+
+  int matches = grep_buffer(r, buf, len, NULL, &options, out);
+  fclose(out);
+  regex_free(r);
+
+  int val = matches != -1 && output_len == strlen(expected) &&
+            memcmp(output, expected, output_len) == 0;
+
+  free(output);
+  return val;
+}
+
+// more chunks than workers, so the workers take several each and the
+// output has to be put back in order.
+int test_chunked_grep() {
+  size_t len = GREP_CHUNK_SIZE * 3 + 12345;
+  char *buf = new_lines(len);
+  char *expected = expected_lines(buf, len, "x(a|b)*y");
+
+  int val = test_grep(buf, len, "x(a|b)*y", 0, 4, expected);
+
+  free(expected);
+  free(buf);
+
+  return val;
+}
+
+int test_grep_file(const char *buf, const char *regex, const char *expected) {
+  printf("Testing '%s' on a file...\n", regex);
+
+  char path[] = "/tmp/grep_testXXXXXX";
+  int fd = mkstemp(path);
+
+  if (fd == -1)
+    return 0;
+
+  int written = write(fd, buf, strlen(buf)) == (ssize_t)strlen(buf);
+  close(fd);
+
+  struct regex *r = regex_compile(regex);
+  char *output = NULL;
+  size_t output_len = 0;
+  FILE *out = open_memstream(&output, &output_len);
+
+  int matches = grep_file(r, path, NULL, out);
+  fclose(out);
+  regex_free(r);
+  remove(path);
+
+  int val = written && matches != -1 && output_len == strlen(expected) &&
+            memcmp(output, expected, output_len) == 0;
+
+  free(output);
+  return val;
+}
+
+// every engine the cpu has must find the same newlines as the scalar one,
+// wherever they are relative to the vector width.
+int test_find_newline() {
+  printf("Testing newline search...\n");
+
+  char buf[200];
+  int val = 1;
+
+  for (int at = 0; at < 100 && val; at++) {
+    memset(buf, 'a', sizeof(buf));
+    buf[at] = '\n';
+    buf[at + 64] = '\n';
+
+    for (int engine = GREP_SCALAR; engine <= grep_best_engine(); engine++) {
+      for (int from = 0; from <= at + 65; from += 7) {
+        const char *expected =
+            from <= at ? buf + at : (from <= at + 64 ? buf + at + 64 : NULL);
+
+        if (grep_find_newline(buf + from, buf + sizeof(buf), engine) !=
+            expected)
+          val = 0;
+      }
+    }
+  }
+
+  return val;
+}
+
+// lines of a, b, x and y of every length up to 40.
+char *new_lines(size_t len) {
+  char *buf = (char *)malloc(len);
+
+  for (size_t i = 0; i < len; i++) {
+    unsigned int h = (i * 2654435761u) >> 11;
+    buf[i] = h % 41 == 0 ? '\n' : "abxy"[h % 4];
+  }
+
+  return buf;
+}
+
+char *expected_lines(const char *buf, size_t len, const char *regex) {
+  struct regex *r = regex_compile(regex);
+  char *expected = (char *)malloc(len + 2);
+  size_t expected_len = 0;
+  size_t from = 0;
+
+  while (from < len) {
+    size_t to = from;
+
+    while (to < len && buf[to] != '\n')
+      to++;
+
+    int start;
+    int end;
+
+    if (regex_search(r, buf + from, to - from, &start, &end) == 1) {
+      memcpy(expected + expected_len, buf + from, to - from);
+      expected_len += to - from;
+      expected[expected_len++] = '\n';
+    }
+
+    from = to + 1;
+  }
+
+  expected[expected_len] = '\0';
+  regex_free(r);
+
+  return expected;
+}
@@ -0,0 +1,145 @@
+#include "../src/regex.h"
+
+// written by the check-matchers target from test/matchers.rules.
+#include "../generated_matchers.c"
+
+typedef int (*generated_matcher)(const char *str, int str_len);
+
+typedef struct generated_rule {
+  const char *name;
+  generated_matcher match;
+} generated_rule;
+
+int test_matcher(const char *name, generated_matcher match,
+                 const char *pattern, const char **strs);
+int read_rules(const char *path, char names[][32], char patterns[][64],
+               int max);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+// rules has to list the matchers in the order of test/matchers.rules.
+void test() {
+  printf("Testing matchers generated from a rules file...\n");
+
+  int tests[20];
+  int total = 0;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  generated_rule rules[] = {
+      {"a_star_b", a_star_b}, {"ab_repeated", ab_repeated},
+      {"third_from_end", third_from_end}, {"pairs", pairs},
+      {"cdef", cdef}, {"digits", digits}, {"nested", nested},
+      {"empty", empty}};
+  int rules_len = sizeof(rules) / sizeof(rules[0]);
+
+  const char *strs[] = {"",      "a",     "b",        "ab",       "abab",
+                        "aab",   "abba",  "baab",     "aaaaaaab", "abcdef",
+                        "abcdf", "01234", "abcdedef", "a b",      "ababa",
+                        "bbbb",  "aabab", "babab",    "abbabaab", NULL};
+
+  char names[20][32];
+  char patterns[20][64];
+  int count = read_rules("test/matchers.rules", names, patterns, 20);
+
+  if (count != rules_len) {
+    printf("test/matchers.rules has %i rules instead of %i\n", count,
+           rules_len);
+    count = 0;
+    total = 1;
+    tests[0] = 0;
+  }
+
+  for (int i = 0; i < count; i++) {
+    total++;
+    printf("T%i Testing...\n", total);
+
+    int t = strcmp(names[i], rules[i].name) == 0 &&
+            test_matcher(names[i], rules[i].match, patterns[i], strs);
+
+    if (t == 1) {
+      printf("T%i is successful\n", total);
+      success++;
+      tests[total - 1] = 1;
+    } else {
+      printf("T%i has failed\n", total);
+      tests[total - 1] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing generated matchers from a rules file\n\n");
+}
+
+// the generated matcher has to agree with regex_match on every prefix of
+// every string.
+int test_matcher(const char *name, generated_matcher match,
+                 const char *pattern, const char **strs) {
+  printf("Testing matcher %s for '%s'...\n", name, pattern);
+
+  regex *r = regex_compile(pattern);
+
+  if (r == NULL)
+    return 0;
+
+  int val = 1;
+
+  for (int k = 0; strs[k] != NULL && val; k++) {
+    for (int len = strlen(strs[k]); len >= 0 && val; len--) {
+      if (match(strs[k], len) != regex_match(r, strs[k], len)) {
+        printf("'%.*s' did not give %i\n", len, strs[k],
+               regex_match(r, strs[k], len));
+        val = 0;
+      }
+    }
+  }
+
+  regex_free(r);
+  return val;
+}
+
+// the rules are read the way generate_matchers reads them, a name and then
+// the pattern on every line that is not empty.
+int read_rules(const char *path, char names[][32], char patterns[][64],
+               int max) {
+  FILE *in = fopen(path, "r");
+
+  if (in == NULL)
+    return -1;
+
+  char line[128];
+  int count = 0;
+
+  while (count < max && fgets(line, sizeof(line), in) != NULL) {
+    char name[32] = "";
+    char pattern[64] = "";
+
+    if (sscanf(line, "%31s %63s", name, pattern) < 1)
+      continue;
+
+    strcpy(names[count], name);
+    strcpy(patterns[count], pattern);
+    count++;
+  }
+
+  fclose(in);
+  return count;
+}
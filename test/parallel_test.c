@@ -0,0 +1,184 @@
+#include "../src/parallel.h"
+
+int test_parallel(const char *regex, const char *fill, const char *planted,
+                  int threads, int full_dfa);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing parallel matches...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *tests_regex_inputs[20];
+  const char *tests_fills[20];
+  const char *tests_planted[20];
+  int tests_threads[20];
+  int tests_full_dfas[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_regex_inputs[i] = "";
+    tests_fills[i] = "";
+    tests_planted[i] = "";
+    tests_threads[i] = 0;
+    tests_full_dfas[i] = 0;
+  }
+
+  // an empty fill stands for a random string of a and b.
+  tests_regex_inputs[0] = "(a|b)*a(a|b)a(a|b)b";
+  tests_threads[0] = 4;
+
+  tests_regex_inputs[1] = "(a|b)*a(a|b)a(a|b)b";
+  tests_planted[1] = "aaabab";
+  tests_threads[1] = 3;
+
+  tests_regex_inputs[2] = "(a|b)*a(a|b)a(a|b)b";
+  tests_planted[2] = "aaabab";
+  tests_threads[2] = 8;
+  tests_full_dfas[2] = 1;
+
+  tests_regex_inputs[3] = "(ab|ba)*(a|bb)*";
+  tests_fills[3] = "ab";
+  tests_threads[3] = 4;
+
+  // the only match sits at the very end, in the last chunk.
+  tests_regex_inputs[4] = "abc(d|e)*f";
+  tests_fills[4] = "xyz";
+  tests_planted[4] = "abcdedef";
+  tests_threads[4] = 4;
+
+  tests_regex_inputs[5] = "abc(d|e)*f";
+  tests_fills[5] = "abcdedexyz";
+  tests_threads[5] = 4;
+
+  tests_regex_inputs[6] = "(a|b)*";
+  tests_threads[6] = 2;
+
+  tests_regex_inputs[7] = "";
+  tests_fills[7] = "x";
+
+  tests_regex_inputs[8] = "(0|1|2|3|4|5|6|7|8|9)(0|1|2|3|4|5|6|7|8|9)*";
+  tests_fills[8] = "12 34 5";
+  tests_threads[8] = 0;
+
+  tests_regex_inputs[9] = "(abcd|c)(d|e)*f";
+  tests_fills[9] = "xyz";
+  tests_planted[9] = "abcdedef";
+  tests_threads[9] = 2;
+
+  for (int i = 0; i < 20; i++) {
+    if (strlen(tests_regex_inputs[i]) == 0 && strlen(tests_fills[i]) == 0) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_parallel(tests_regex_inputs[i], tests_fills[i],
+                          tests_planted[i], tests_threads[i],
+                          tests_full_dfas[i]);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing parallel matches\n\n");
+}
+
+int test_parallel(const char *regex, const char *fill, const char *planted,
+                  int threads, int full_dfa) {
+  printf("Testing a parallel match with regex '%s' on %i threads...\n",
+         regex, threads);
+
+  regex_options options;
+  options.dfa_cache_size = 0;
+  options.full_dfa = full_dfa;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = 0;
+
+  struct regex *r = regex_compile_with_options(regex, &options, NULL);
+
+  if (r == NULL)
+    return 0;
+
+  // long enough for every thread to get a chunk of its own, with the
+  // planted string across the middle, where two chunks meet for an even
+  // number of threads, and at the end.
+  int len = PARALLEL_MIN_CHUNK * 9 + 123;
+  int fill_len = strlen(fill);
+  int planted_len = strlen(planted);
+  char *str = (char *)malloc(len);
+
+  for (int i = 0; i < len; i++) {
+    if (fill_len == 0)
+      str[i] = ((i * 2654435761u) >> 13) & 1 ? 'a' : 'b';
+    else
+      str[i] = fill[i % fill_len];
+  }
+
+  memcpy(str + len / 2 - 3, planted, planted_len);
+  memcpy(str + len - planted_len, planted, planted_len);
+
+  int val = 1;
+
+  // prefixes of every length class, from the whole string down to one that
+  // stays on the calling thread.
+  int lens[4] = {len, len - 1, PARALLEL_MIN_CHUNK * 2 + 7, 100};
+
+  for (int k = 0; k < 4 && val; k++) {
+    int expected = regex_match(r, str, lens[k]);
+    int evaluated = regex_match_parallel(r, str, lens[k], threads);
+
+    if (expected != evaluated)
+      val = 0;
+
+    int expected_start = -1;
+    int expected_end = -1;
+    size_t start = 0;
+    size_t end = 0;
+    int expected_found =
+        regex_search(r, str, lens[k], &expected_start, &expected_end);
+    int found =
+        regex_search_parallel(r, str, lens[k], threads, &start, &end);
+
+    if (expected_found != found ||
+        (found == 1 &&
+         (start != (size_t)expected_start || end != (size_t)expected_end)))
+      val = 0;
+
+    printf("%i bytes: match %i, search %i [%zu, %zu)\n", lens[k], evaluated,
+           found, start, end);
+  }
+
+  free(str);
+  regex_free(r);
+  return val;
+}
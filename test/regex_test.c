@@ -3,6 +3,8 @@
 int test_postfix(const char *regex, const char *expected_val);
 int test_standardize(const char *regex, const char *expected_val,
                      int expected_len);
+int test_literals(const char *regex, const char *expected_prefix,
+                  const char *expected_suffix, const char *expected_required);
 
 void test();
 
@@ -14,11 +16,11 @@ int main() {
 void test() {
   printf("Testing regex...\n");
 
-  int tests[40];
-  int total = 40;
+  int tests[60];
+  int total = 60;
   int success = 0;
 
-  for (int i = 0; i < 40; i++)
+  for (int i = 0; i < 60; i++)
     tests[i] = -1;
 
   const char *postfix_tests_inputs[20];
@@ -112,11 +114,69 @@ void test() {
     }
   }
 
+  const char *literals_tests_inputs[20];
+  const char *literals_tests_expected_prefixes[20];
+  const char *literals_tests_expected_suffixes[20];
+  const char *literals_tests_expected_requireds[20];
+
+  for (int i = 0; i < 20; i++) {
+    literals_tests_inputs[i] = "";
+    literals_tests_expected_prefixes[i] = "";
+    literals_tests_expected_suffixes[i] = "";
+    literals_tests_expected_requireds[i] = "";
+  }
+
+  literals_tests_inputs[0] = "err(o|0)r";
+  literals_tests_expected_prefixes[0] = "err";
+  literals_tests_expected_suffixes[0] = "r";
+  literals_tests_expected_requireds[0] = "err";
+
+  literals_tests_inputs[1] = "(a|b)*xyzw(c|d)*";
+  literals_tests_expected_prefixes[1] = "";
+  literals_tests_expected_suffixes[1] = "";
+  literals_tests_expected_requireds[1] = "xyzw";
+
+  literals_tests_inputs[2] = "abc(x|y)(de|fe)";
+  literals_tests_expected_prefixes[2] = "abc";
+  literals_tests_expected_suffixes[2] = "e";
+  literals_tests_expected_requireds[2] = "abc";
+
+  literals_tests_inputs[3] = "get|got";
+  literals_tests_expected_prefixes[3] = "g";
+  literals_tests_expected_suffixes[3] = "t";
+  literals_tests_expected_requireds[3] = "g";
+
+  literals_tests_inputs[4] = "hello";
+  literals_tests_expected_prefixes[4] = "hello";
+  literals_tests_expected_suffixes[4] = "hello";
+  literals_tests_expected_requireds[4] = "hello";
+
+  for (int i = 0; i < 20; i++) {
+    if (strlen(literals_tests_inputs[i]) == 0) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 40 + 1);
+    int t = test_literals(literals_tests_inputs[i],
+                          literals_tests_expected_prefixes[i],
+                          literals_tests_expected_suffixes[i],
+                          literals_tests_expected_requireds[i]);
+    if (t == 1) {
+      printf("T%i is successful\n", i + 40 + 1);
+      success++;
+      tests[i + 40] = 1;
+    } else {
+      printf("T%i has failed\n", i + 40 + 1);
+      tests[i + 40] = 0;
+    }
+  }
+
   if (success == total) {
     printf("All tests were successful\n");
   } else {
     printf("Some tests are failed:\n");
-    for (int i = 0; i < 40; i++) {
+    for (int i = 0; i < 60; i++) {
       if (tests[i] == 0)
         printf("  T%i  ", i + 1);
     }
@@ -130,7 +190,7 @@ void test() {
 int test_postfix(const char *regex, const char *expected_val) {
   printf("Testing regex '%s' for postfix...\n", regex);
   int len = strlen(regex);
-  char *postfix = regex_to_postfix(regex, len);
+  char *postfix = regex_to_postfix(regex, len, NULL);
 
   if (strcmp(postfix, expected_val) == 0) {
     return 1;
@@ -146,7 +206,7 @@ int test_standardize(const char *regex, const char *expected_val,
   printf("Testing regex '%s' for standardization...\n", regex);
   int len = strlen(regex);
   int slen;
-  char *standardized = standardize_regex(regex, len, &slen);
+  char *standardized = standardize_regex(regex, len, &slen, NULL);
 
   if (strcmp(standardized, expected_val) == 0 && slen == expected_len) {
     return 1;
@@ -156,3 +216,24 @@ int test_standardize(const char *regex, const char *expected_val,
 
   return 0;
 }
+
+int test_literals(const char *regex, const char *expected_prefix,
+                  const char *expected_suffix, const char *expected_required) {
+  printf("Testing regex '%s' for literals...\n", regex);
+
+  struct regex *r = regex_compile(regex);
+
+  if (r == NULL)
+    return 0;
+
+  regex_literals *l = &r->literals;
+  int val = l->prefix_len == (int)strlen(expected_prefix) &&
+            memcmp(l->prefix, expected_prefix, l->prefix_len) == 0 &&
+            l->suffix_len == (int)strlen(expected_suffix) &&
+            memcmp(l->suffix, expected_suffix, l->suffix_len) == 0 &&
+            l->required_len == (int)strlen(expected_required) &&
+            memcmp(l->required, expected_required, l->required_len) == 0;
+
+  regex_free(r);
+  return val;
+}
@@ -0,0 +1,190 @@
+#include "../src/regex.h"
+
+int test_search(const char *str, const char *regex, int expected_start,
+                int expected_end);
+int test_nul_search(const char *regex, int expected_start, int expected_end);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing search...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *tests_string_inputs[20];
+  const char *tests_regex_inputs[20];
+  int tests_expected_starts[20];
+  int tests_expected_ends[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_string_inputs[i] = "";
+    tests_regex_inputs[i] = "";
+    tests_expected_starts[i] = -1;
+    tests_expected_ends[i] = -1;
+  }
+
+  tests_string_inputs[0] = "xxabababyy";
+  tests_regex_inputs[0] = "ab(ab)*";
+  tests_expected_starts[0] = 2;
+  tests_expected_ends[0] = 8;
+
+  tests_string_inputs[1] = "xxbabaxbyy";
+  tests_regex_inputs[1] = "abab(ab)*";
+  tests_expected_starts[1] = -1;
+  tests_expected_ends[1] = -1;
+
+  // the first match to end is c, but abcd starts further left.
+  tests_string_inputs[2] = "abcd";
+  tests_regex_inputs[2] = "abcd|c";
+  tests_expected_starts[2] = 0;
+  tests_expected_ends[2] = 4;
+
+  tests_string_inputs[3] = "bbb";
+  tests_regex_inputs[3] = "a*";
+  tests_expected_starts[3] = 0;
+  tests_expected_ends[3] = 0;
+
+  tests_string_inputs[4] = "xxmdmmnbnq";
+  tests_regex_inputs[4] = "a|(bc|df)*mdm*(nbn)*|d*wd*";
+  tests_expected_starts[4] = 2;
+  tests_expected_ends[4] = 9;
+
+  tests_string_inputs[5] = "zzaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaabz";
+  tests_regex_inputs[5] = "((a*)*)*b";
+  tests_expected_starts[5] = 2;
+  tests_expected_ends[5] = 47;
+
+  tests_string_inputs[6] = "qqqqqqqqab";
+  tests_regex_inputs[6] = "ab";
+  tests_expected_starts[6] = 8;
+  tests_expected_ends[6] = 10;
+
+  // the automaton only starts where the prefix abab is first found.
+  tests_string_inputs[7] = "xxabzzabababyy";
+  tests_regex_inputs[7] = "abab(ab)*";
+  tests_expected_starts[7] = 6;
+  tests_expected_ends[7] = 12;
+
+  tests_string_inputs[8] = "xxerrzzerr0r";
+  tests_regex_inputs[8] = "err(o|0)r";
+  tests_expected_starts[8] = 7;
+  tests_expected_ends[8] = 12;
+
+  for (int i = 0; i < 20; i++) {
+    if (strlen(tests_regex_inputs[i]) == 0 ||
+        strlen(tests_string_inputs[i]) == 0) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_search(tests_string_inputs[i], tests_regex_inputs[i],
+                        tests_expected_starts[i], tests_expected_ends[i]);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  // a nul byte in the haystack is an ordinary byte, not an epsilon move.
+  for (int k = 0; k < 2; k++) {
+    total++;
+    printf("T%i Testing...\n", total);
+
+    int t = k == 0 ? test_nul_search("(a|b)c", 2, 4)
+                   : test_nul_search("a|b", 2, 3);
+
+    if (t == 1) {
+      printf("T%i is successful\n", total);
+      success++;
+      tests[total - 1] = 1;
+    } else {
+      printf("T%i has failed\n", total);
+      tests[total - 1] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing search\n\n");
+}
+
+int test_search(const char *str, const char *regex, int expected_start,
+                int expected_end) {
+  printf("Searching string '%s' for regex '%s'...\n", str, regex);
+
+  struct regex *r = regex_compile(regex);
+
+  if (r == NULL)
+    return -1;
+
+  int val = 1;
+
+  // the second search goes through the states cached by the first one
+  for (int i = 0; i < 2; i++) {
+    int start = -1;
+    int end = -1;
+    int found = regex_search(r, str, strlen(str), &start, &end);
+
+    if (found != (expected_start != -1) || start != expected_start ||
+        end != expected_end)
+      val = 0;
+  }
+
+  regex_free(r);
+  return val;
+}
+
+// the search and the nfa simulation behind it both have to skip the nul.
+int test_nul_search(const char *regex, int expected_start, int expected_end) {
+  printf("Searching a string with a nul byte for regex '%s'...\n", regex);
+
+  const char str[] = "x\0bc";
+  int len = sizeof(str) - 1;
+  struct regex *r = regex_compile(regex);
+
+  if (r == NULL)
+    return 0;
+
+  arena *mem = new_arena(4096);
+  int start = -1;
+  int end = -1;
+  int nfa_start = -1;
+  int nfa_end = -1;
+
+  int val = mem != NULL && regex_search(r, str, len, &start, &end) == 1 &&
+            start == expected_start && end == expected_end &&
+            search_string_in_nfa(r->n, str, len, len, &nfa_start, &nfa_end,
+                                 mem) == 1 &&
+            nfa_start == expected_start && nfa_end == expected_end;
+
+  free_arena(mem);
+  regex_free(r);
+  return val;
+}
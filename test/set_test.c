@@ -0,0 +1,282 @@
+#include "../src/regex_set.h"
+#include <pthread.h>
+
+#define SHARED_THREADS 8
+
+typedef struct shared_set_match {
+  const regex_set *s;
+  int failed;
+  pthread_t thread;
+} shared_set_match;
+
+int test_set(const char *str, const char **regexes, int count,
+             size_t cache_size, const char *expected_val);
+int test_shared_set(size_t cache_size);
+int test_literal_set(int count);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing regex sets...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *regexes[] = {"(ab)*", "ab(ab)*", "a|(bc|df)*mdm*(nbn)*|d*wd*",
+                           "(a|b)*a(a|b)a(a|b)b", "((a*)*)*b", "(a|b*)*"};
+  int count = sizeof(regexes) / sizeof(regexes[0]);
+
+  const char *tests_string_inputs[20];
+  size_t tests_cache_sizes[20];
+  const char *tests_expected_values[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_string_inputs[i] = "";
+    tests_cache_sizes[i] = 0;
+    tests_expected_values[i] = "";
+  }
+
+  tests_string_inputs[0] = "abababab";
+  tests_expected_values[0] = "110001";
+
+  tests_string_inputs[1] = "bcbcbcmdnbnnbn";
+  tests_expected_values[1] = "001000";
+
+  tests_string_inputs[2] = "abbabaababbbabaabbbabaab";
+  tests_expected_values[2] = "000101";
+
+  tests_string_inputs[3] = "aaaaaaaaab";
+  tests_expected_values[3] = "000111";
+
+  tests_string_inputs[4] = "xyz";
+  tests_expected_values[4] = "000000";
+
+  // a tiny cache makes the dfa give up, and the nfa has to report the same
+  // patterns.
+  tests_string_inputs[5] = "abbabaababbbabaabbbabaababbabaababbbabaabbbabaab"
+                           "abbabaababbbabaabbbabaab";
+  tests_cache_sizes[5] = 1;
+  tests_expected_values[5] = "000101";
+
+  for (int i = 0; i < 20; i++) {
+    if (strlen(tests_string_inputs[i]) == 0) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_set(tests_string_inputs[i], regexes, count,
+                     tests_cache_sizes[i], tests_expected_values[i]);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  // one set matched from many threads at once, with a cache that holds
+  // every state and with one so small the nfa takes over.
+  for (int k = 0; k < 2; k++) {
+    total++;
+    printf("T%i Testing...\n", total);
+
+    int t = test_shared_set(k == 0 ? 0 : 1);
+
+    if (t == 1) {
+      printf("T%i is successful\n", total);
+      success++;
+      tests[total - 1] = 1;
+    } else {
+      printf("T%i has failed\n", total);
+      tests[total - 1] = 0;
+    }
+  }
+
+  // a set of few literals gets a teddy, and one of more than it can tell
+  // apart goes without, matching the same either way.
+  for (int k = 0; k < 2; k++) {
+    total++;
+    printf("T%i Testing...\n", total);
+
+    int t = test_literal_set(k == 0 ? 8 : REGEX_SET_MAX_LITERALS + 6);
+
+    if (t == 1) {
+      printf("T%i is successful\n", total);
+      success++;
+      tests[total - 1] = 1;
+    } else {
+      printf("T%i has failed\n", total);
+      tests[total - 1] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing regex sets\n\n");
+}
+
+int test_set(const char *str, const char **regexes, int count,
+             size_t cache_size, const char *expected_val) {
+  printf("Testing string '%s' with a set of %i regexes...\n", str, count);
+
+  regex_options options;
+  options.dfa_cache_size = cache_size;
+  options.full_dfa = 0;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = 0;
+
+  regex_set *s = regex_set_compile(regexes, count, &options, NULL);
+
+  if (s == NULL)
+    return -1;
+
+  char matched[20];
+  int val = 1;
+
+  // every pattern of the set has to agree with matching it on its own
+  for (int k = 0; k < 2; k++) {
+    int matches = regex_set_match(s, str, strlen(str), matched);
+    int expected_matches = 0;
+
+    for (int i = 0; i < count; i++) {
+      if (matched[i] != expected_val[i] - '0' ||
+          evaluate_string(str, regexes[i], 0) != matched[i])
+        val = 0;
+
+      expected_matches += expected_val[i] - '0';
+    }
+
+    if (matches != expected_matches)
+      val = 0;
+  }
+
+  regex_set_free(s);
+  return val;
+}
+
+static void *run_shared_set_match(void *arg) {
+  shared_set_match *m = (shared_set_match *)arg;
+  char str[64];
+  char matched[2];
+
+  for (int i = 0; i < 2000 && !m->failed; i++) {
+    int len = i % 60;
+
+    // a string of b with an a at i % 7, which the first pattern matches
+    // when the a is third from the end, and the second when there is none.
+    memset(str, 'b', len);
+
+    if (i % 7 < len)
+      str[i % 7] = 'a';
+
+    int matches = regex_set_match(m->s, str, len, matched);
+
+    if (matches == -1 || matched[0] != (len >= 3 && i % 7 == len - 3) ||
+        matched[1] != (i % 7 >= len) || matches != matched[0] + matched[1])
+      m->failed = 1;
+  }
+
+  return NULL;
+}
+
+// every thread matches with the same set, which can only have made as many
+// contexts as there were threads running at once.
+int test_shared_set(size_t cache_size) {
+  printf("Testing a set shared by %i threads...\n", SHARED_THREADS);
+
+  regex_options options;
+  options.dfa_cache_size = cache_size;
+  options.full_dfa = 0;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = 0;
+
+  const char *regexes[] = {"(a|b)*a(a|b)(a|b)", "b*"};
+  regex_set *s = regex_set_compile(regexes, 2, &options, NULL);
+
+  if (s == NULL)
+    return 0;
+
+  shared_set_match matches[SHARED_THREADS];
+  int started = 0;
+  int val = 1;
+
+  for (; started < SHARED_THREADS; started++) {
+    matches[started].s = s;
+    matches[started].failed = 0;
+
+    if (pthread_create(&matches[started].thread, NULL, run_shared_set_match,
+                       &matches[started]) != 0)
+      break;
+  }
+
+  for (int i = 0; i < started; i++) {
+    pthread_join(matches[i].thread, NULL);
+
+    if (matches[i].failed)
+      val = 0;
+  }
+
+  if (started == 0 || s->pool->slots_used > started + 1)
+    val = 0;
+
+  regex_set_free(s);
+  return val;
+}
+
+// pattern i is the literal lit followed by i, so only "lit" followed by i
+// matches it.
+int test_literal_set(int count) {
+  printf("Testing a set of %i literals...\n", count);
+
+  char(*patterns)[8] = (char(*)[8])malloc(8 * count);
+  const char **regexes = (const char **)malloc(sizeof(char *) * count);
+  char *matched = (char *)malloc(count);
+
+  for (int i = 0; i < count; i++) {
+    snprintf(patterns[i], 8, "lit%i", i);
+    regexes[i] = patterns[i];
+  }
+
+  regex_set *s = regex_set_compile(regexes, count, NULL, NULL);
+  int val = s != NULL &&
+            (s->prefilter != NULL) == (count <= REGEX_SET_MAX_LITERALS);
+
+  for (int i = 0; i < count && val; i++) {
+    if (regex_set_match(s, patterns[i], strlen(patterns[i]), matched) != 1 ||
+        matched[i] != 1)
+      val = 0;
+  }
+
+  if (val && regex_set_match(s, "lit", 3, matched) != 0)
+    val = 0;
+
+  regex_set_free(s);
+  free(matched);
+  free(regexes);
+  free(patterns);
+  return val;
+}
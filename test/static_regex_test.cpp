@@ -0,0 +1,109 @@
+#include "../src/regex.h"
+#include "../src/static_regex.h"
+
+// patterns are template arguments, so every test is its own function that
+// checks the static regex against the runtime one on the same strings.
+template <static_regex_detail::pattern_string Pattern>
+int test_static_regex(const char **strs);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+// matching happens at compile time too.
+static_assert(static_regex<"ab(ab)*">::match("ababab"));
+static_assert(!static_regex<"ab(ab)*">::match("aba"));
+static_assert(static_regex<"">::match(""));
+static_assert(!static_regex<"a|b">::match("ab"));
+
+void test() {
+  printf("Testing static regexes...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *strs[] = {"",      "a",     "b",        "ab",       "abab",
+                        "aab",   "abba",  "baab",     "aaaaaaab", "abcdef",
+                        "abcdf", "01234", "abcdedef", "a b",      "ababa",
+                        "bbbb",  "aabab", "babab",    NULL};
+
+  int (*tests_functions[20])(const char **);
+
+  for (int i = 0; i < 20; i++)
+    tests_functions[i] = NULL;
+
+  tests_functions[0] = test_static_regex<"ab(ab)*">;
+  tests_functions[1] = test_static_regex<"a*b">;
+  tests_functions[2] = test_static_regex<"(a|b)*a(a|b)a(a|b)b">;
+  tests_functions[3] = test_static_regex<"(ab|ba)*(a|bb)*">;
+  tests_functions[4] = test_static_regex<"abc(d|e)*f">;
+  tests_functions[5] = test_static_regex<"">;
+  tests_functions[6] = test_static_regex<"(0|1|2|3|4)*">;
+  tests_functions[7] = test_static_regex<"a.b|b*">;
+
+  for (int i = 0; i < 20; i++) {
+    if (tests_functions[i] == NULL) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = tests_functions[i](strs);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing static regexes\n\n");
+}
+
+template <static_regex_detail::pattern_string Pattern>
+int test_static_regex(const char **strs) {
+  printf("Testing static regex '%s' with %i dfa states...\n", Pattern.data,
+         static_regex<Pattern>::number_of_states);
+
+  regex *r = regex_compile(Pattern.data);
+
+  if (r == NULL)
+    return 0;
+
+  int val = 1;
+
+  for (int i = 0; strs[i] != NULL && val; i++) {
+    int expected = regex_match(r, strs[i], strlen(strs[i]));
+
+    if (static_regex<Pattern>::match(strs[i]) != expected) {
+      printf("'%s' gave %i instead of %i\n", strs[i], !expected, expected);
+      val = 0;
+    }
+  }
+
+  regex_free(r);
+  return val;
+}
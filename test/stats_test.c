@@ -0,0 +1,299 @@
+#include "../src/regex.h"
+#include <pthread.h>
+
+#define SHARED_THREADS 4
+#define SHARED_MATCHES 500
+
+int test_stats(const char *regex, const char **strs, int full_dfa,
+               int search, int expected_hits, int expected_misses,
+               int expected_lazy_states);
+int test_shared_stats();
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+#ifdef REGEX_STATS
+  printf("Testing stats...\n");
+#else
+  printf("Testing stats without REGEX_STATS...\n");
+#endif
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *tests_regex_inputs[20];
+  const char *tests_string_inputs[20][4];
+  int tests_full_dfa[20];
+  int tests_search[20];
+  int tests_hits[20];
+  int tests_misses[20];
+  int tests_lazy_states[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_regex_inputs[i] = NULL;
+    tests_string_inputs[i][0] = NULL;
+    tests_full_dfa[i] = 0;
+    tests_search[i] = 0;
+    tests_hits[i] = -1;
+    tests_misses[i] = -1;
+    tests_lazy_states[i] = -1;
+  }
+
+  // the first match builds every transition it takes, the second finds them
+  // all, and the lazy dfa ends with its dead and initial states and one for
+  // each byte of abb.
+  const char *t1[] = {"abb", "abb", NULL};
+  tests_regex_inputs[0] = "(a|b)*abb";
+  memcpy(tests_string_inputs[0], t1, sizeof(t1));
+  tests_hits[0] = 3;
+  tests_misses[0] = 3;
+  tests_lazy_states[0] = 5;
+
+  const char *t2[] = {"abb", "ab", "", NULL};
+  tests_regex_inputs[1] = "(a|b)*abb";
+  memcpy(tests_string_inputs[1], t2, sizeof(t2));
+  tests_full_dfa[1] = 1;
+  tests_hits[1] = 0;
+  tests_misses[1] = 0;
+
+  const char *t3[] = {"xxabab", "ba", NULL};
+  tests_regex_inputs[2] = "ab(ab)*|ba";
+  memcpy(tests_string_inputs[2], t3, sizeof(t3));
+  tests_search[2] = 1;
+
+  // reading a leads back to the initial state, so the match builds one
+  // transition and no state.
+  const char *t4[] = {"", "a", NULL};
+  tests_regex_inputs[3] = "a*";
+  memcpy(tests_string_inputs[3], t4, sizeof(t4));
+  tests_hits[3] = 0;
+  tests_misses[3] = 1;
+  tests_lazy_states[3] = 2;
+
+  for (int i = 0; i < 20; i++) {
+    if (tests_regex_inputs[i] == NULL) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_stats(tests_regex_inputs[i], tests_string_inputs[i],
+                       tests_full_dfa[i], tests_search[i], tests_hits[i],
+                       tests_misses[i], tests_lazy_states[i]);
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  // stats read while other threads match with the same regex.
+  total++;
+  printf("T%i Testing...\n", total);
+
+  if (test_shared_stats() == 1) {
+    printf("T%i is successful\n", total);
+    success++;
+    tests[total - 1] = 1;
+  } else {
+    printf("T%i has failed\n", total);
+    tests[total - 1] = 0;
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing stats\n\n");
+}
+
+// every expectation of -1 is not checked. without REGEX_STATS every counter
+// has to stay at zero.
+int test_stats(const char *regex, const char **strs, int full_dfa,
+               int search, int expected_hits, int expected_misses,
+               int expected_lazy_states) {
+  printf("Testing stats of '%s'...\n", regex);
+
+  regex_options options;
+  options.dfa_cache_size = 0;
+  options.full_dfa = full_dfa;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = 1;
+
+  struct regex *r = regex_compile_with_options(regex, &options, NULL);
+
+  if (r == NULL)
+    return 0;
+
+  int matches = 0;
+
+  for (; strs[matches] != NULL; matches++) {
+    int start;
+    int end;
+
+    if (search)
+      regex_search(r, strs[matches], strlen(strs[matches]), &start, &end);
+    else
+      regex_match(r, strs[matches], strlen(strs[matches]));
+  }
+
+  regex_stats stats;
+  regex_get_stats(r, &stats);
+
+  regex_alloc_stats alloc_stats;
+  regex_get_alloc_stats(r, &alloc_stats);
+
+  int nfa_states = r->n->number_of_states;
+  int nfa_closures = r->n->number_of_closures;
+  int full_states = r->full != NULL ? r->full->number_of_states : 0;
+  regex_free(r);
+
+#ifdef REGEX_STATS
+  int val = stats.matches == (uint64_t)matches;
+
+  uint64_t compile_ns =
+      stats.standardize_ns + stats.postfix_ns + stats.nfa_ns + stats.dfa_ns;
+
+  if (compile_ns == 0)
+    val = 0;
+
+  if (matches > 0 && stats.match_ns == 0)
+    val = 0;
+
+  if (stats.closures < (uint64_t)nfa_closures ||
+      stats.heap_allocations < alloc_stats.compile_heap_allocations)
+    val = 0;
+
+  if (full_dfa && stats.states != nfa_states + full_states)
+    val = 0;
+
+  // only the entry states of the nfa have a closure, and a full dfa builds
+  // no more of them at match time.
+  if (nfa_closures >= nfa_states ||
+      (full_dfa && stats.closures != (uint64_t)nfa_closures))
+    val = 0;
+
+  if (expected_lazy_states != -1 &&
+      stats.states != nfa_states + expected_lazy_states)
+    val = 0;
+
+  if (expected_hits != -1 && stats.dfa_cache_hits != (uint64_t)expected_hits)
+    val = 0;
+
+  if (expected_misses != -1 &&
+      stats.dfa_cache_misses != (uint64_t)expected_misses)
+    val = 0;
+
+  if (!full_dfa && stats.queue_high_water == 0)
+    val = 0;
+
+  if (!val) {
+    printf("Got %llu matches, %i states, %llu closures, %llu hits and "
+           "%llu misses\n",
+           (unsigned long long)stats.matches, stats.states,
+           (unsigned long long)stats.closures,
+           (unsigned long long)stats.dfa_cache_hits,
+           (unsigned long long)stats.dfa_cache_misses);
+  }
+
+  return val;
+#else
+  regex_stats zero;
+  memset(&zero, 0, sizeof(zero));
+
+  (void)expected_hits;
+  (void)expected_misses;
+  (void)expected_lazy_states;
+  (void)nfa_states;
+  (void)nfa_closures;
+  (void)full_states;
+
+  return memcmp(&stats, &zero, sizeof(zero)) == 0;
+#endif
+}
+
+static void *run_shared_matches(void *arg) {
+  const regex *r = (const regex *)arg;
+
+  for (int i = 0; i < SHARED_MATCHES; i++)
+    regex_match(r, "abababb", 7);
+
+  return NULL;
+}
+
+// every match adds a transition per byte to the counters once its context
+// is given back, so after the threads are done they add up exactly.
+int test_shared_stats() {
+  printf("Testing stats of a regex shared by %i threads...\n",
+         SHARED_THREADS);
+
+  regex_options options;
+  options.dfa_cache_size = 0;
+  options.full_dfa = 0;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = 1;
+
+  struct regex *r = regex_compile_with_options("(a|b)*abb", &options, NULL);
+
+  if (r == NULL)
+    return 0;
+
+  pthread_t threads[SHARED_THREADS];
+  int started = 0;
+
+  for (; started < SHARED_THREADS; started++) {
+    if (pthread_create(&threads[started], NULL, run_shared_matches, r) != 0)
+      break;
+  }
+
+  regex_stats stats;
+  int val = started > 0;
+
+  for (int i = 0; i < 100; i++) {
+    regex_get_stats(r, &stats);
+
+    if (regex_dfa_state_count(r) < 0)
+      val = 0;
+  }
+
+  for (int i = 0; i < started; i++)
+    pthread_join(threads[i], NULL);
+
+  regex_get_stats(r, &stats);
+  regex_free(r);
+
+#ifdef REGEX_STATS
+  uint64_t matches = (uint64_t)started * SHARED_MATCHES;
+
+  if (stats.matches != matches ||
+      stats.dfa_cache_hits + stats.dfa_cache_misses != matches * 7)
+    val = 0;
+#else
+  if (stats.matches != 0 || stats.dfa_cache_hits != 0)
+    val = 0;
+#endif
+
+  return val;
+}
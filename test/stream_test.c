@@ -0,0 +1,170 @@
+#include "../src/regex.h"
+
+int test_stream(const char *str, const char *regex, int chunk_len,
+                size_t cache_size, int full_dfa);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing streams...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *tests_string_inputs[20];
+  const char *tests_regex_inputs[20];
+  int tests_chunk_lens[20];
+  size_t tests_cache_sizes[20];
+  int tests_full_dfas[20];
+  int tests_expected_returns[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_string_inputs[i] = "";
+    tests_regex_inputs[i] = "";
+    tests_chunk_lens[i] = 1;
+    tests_cache_sizes[i] = 0;
+    tests_full_dfas[i] = 0;
+    tests_expected_returns[i] = 1;
+  }
+
+  tests_string_inputs[0] = "abababab";
+  tests_regex_inputs[0] = "(ab)*";
+  tests_chunk_lens[0] = 1;
+  tests_expected_returns[0] = 1;
+
+  tests_string_inputs[1] = "abababa";
+  tests_regex_inputs[1] = "(ab)*";
+  tests_chunk_lens[1] = 3;
+  tests_expected_returns[1] = 0;
+
+  tests_string_inputs[2] = "bcbcbcmdnbnnbn";
+  tests_regex_inputs[2] = "a|(bc|df)*mdm*(nbn)*|d*wd*";
+  tests_chunk_lens[2] = 4;
+  tests_expected_returns[2] = 1;
+
+  tests_string_inputs[3] = "bcbcbcmdnbnnbn";
+  tests_regex_inputs[3] = "a|(bc|df)*mdm*(nbn)*|d*wd*";
+  tests_chunk_lens[3] = 5;
+  tests_full_dfas[3] = 1;
+  tests_expected_returns[3] = 1;
+
+  tests_string_inputs[4] = "bcbcdmdnbn";
+  tests_regex_inputs[4] = "a|(bc|df)*mdm*(nbn)*|d*wd*";
+  tests_chunk_lens[4] = 2;
+  tests_full_dfas[4] = 1;
+  tests_expected_returns[4] = 0;
+
+  // with a tiny cache the match run between two feeds flushes the states
+  // the stream was in.
+  tests_string_inputs[5] = "abbabaababbbabaabbbabaab";
+  tests_regex_inputs[5] = "(a|b)*a(a|b)a(a|b)b";
+  tests_chunk_lens[5] = 3;
+  tests_cache_sizes[5] = 1;
+  tests_expected_returns[5] = 1;
+
+  tests_string_inputs[6] = "abbabaababbbabaabbbabbab";
+  tests_regex_inputs[6] = "(a|b)*a(a|b)a(a|b)b";
+  tests_chunk_lens[6] = 7;
+  tests_cache_sizes[6] = 1;
+  tests_expected_returns[6] = 0;
+
+  tests_string_inputs[7] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab";
+  tests_regex_inputs[7] = "((a*)*)*b";
+  tests_chunk_lens[7] = 10;
+  tests_expected_returns[7] = 1;
+
+  for (int i = 0; i < 20; i++) {
+    if (strlen(tests_regex_inputs[i]) == 0 ||
+        strlen(tests_string_inputs[i]) == 0) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    int t = test_stream(tests_string_inputs[i], tests_regex_inputs[i],
+                        tests_chunk_lens[i], tests_cache_sizes[i],
+                        tests_full_dfas[i]);
+
+    if (t == tests_expected_returns[i]) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing streams\n\n");
+}
+
+int test_stream(const char *str, const char *regex, int chunk_len,
+                size_t cache_size, int full_dfa) {
+  printf("Testing string '%s' with regex '%s' in chunks of %i...\n", str,
+         regex, chunk_len);
+
+  regex_options options;
+  options.dfa_cache_size = cache_size;
+  options.full_dfa = full_dfa;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = cache_size > 0;
+
+  struct regex *r = regex_compile_with_options(regex, &options, NULL);
+
+  if (r == NULL)
+    return -1;
+
+  regex_stream *s = regex_stream_new(r);
+
+  if (s == NULL) {
+    regex_free(r);
+    return -1;
+  }
+
+  int len = strlen(str);
+  int val = regex_match(r, str, len);
+
+  // the stream is fed twice to check that a reset starts over.
+  for (int k = 0; k < 2; k++) {
+    regex_stream_reset(s);
+
+    for (int i = 0; i < len; i += chunk_len) {
+      int n = len - i < chunk_len ? len - i : chunk_len;
+
+      if (regex_stream_feed(s, str + i, n) == -1)
+        val = -1;
+
+      // matches in between share the lazy dfa cache with the stream
+      regex_match(r, "ba", 2);
+    }
+
+    if (regex_stream_finish(s) != val)
+      val = -1;
+  }
+
+  regex_stream_free(s);
+  regex_free(r);
+  return val;
+}
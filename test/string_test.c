@@ -2,6 +2,7 @@
 #include <sys/time.h>
 
 int test_strings(const char *str, const char *regex, int expected_val);
+int test_nul_match(const char *regex);
 
 void test();
 
@@ -84,6 +85,46 @@ void test() {
   tests_regex_inputs[11] = "a|(bc|df)*mdm*(nbn)*|d*wd*";
   tests_expected_returns[11] = 0;
 
+  tests_string_inputs[12] = "b";
+  tests_regex_inputs[12] = "(ab*)*";
+  tests_expected_returns[12] = 0;
+
+  tests_string_inputs[13] = "abbaab";
+  tests_regex_inputs[13] = "(ab*)*";
+  tests_expected_returns[13] = 1;
+
+  tests_string_inputs[14] = "aaab";
+  tests_regex_inputs[14] = "(a*)*b";
+  tests_expected_returns[14] = 1;
+
+  tests_string_inputs[15] = "bab";
+  tests_regex_inputs[15] = "(a|b*)*";
+  tests_expected_returns[15] = 1;
+
+  tests_string_inputs[16] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  tests_regex_inputs[16] = "(a|a)*(a|a)*(a|a)*";
+  tests_expected_returns[16] = 1;
+
+  tests_string_inputs[17] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+  tests_regex_inputs[17] = "((a*)*)*b";
+  tests_expected_returns[17] = 0;
+
+  tests_string_inputs[18] = "POST";
+  tests_regex_inputs[18] = "GET|PUT|POST|DELETE";
+  tests_expected_returns[18] = 1;
+
+  tests_string_inputs[19] = "PUTPOST";
+  tests_regex_inputs[19] = "(GET|PUT|POST|DELETE)*";
+  tests_expected_returns[19] = 1;
+
+  tests_string_inputs[20] = "xxPOxxSTxx";
+  tests_regex_inputs[20] = "x*(GET|PUT|POST|DELETE)x*";
+  tests_expected_returns[20] = 0;
+
+  tests_string_inputs[21] = "xxDELETExx";
+  tests_regex_inputs[21] = "x*(GET|PUT|POST|DELETE)x*";
+  tests_expected_returns[21] = 1;
+
   for (int i = 0; i < 40; i++) {
     if (strlen(tests_regex_inputs[i]) == 0 ||
         strlen(tests_string_inputs[i]) == 0) {
@@ -115,6 +156,24 @@ void test() {
     printf(" --- duration: %.3lf ms\n", diff);
   }
 
+  // a nul byte in the string is an ordinary byte, not an epsilon move, in
+  // the nfa simulation and in a stream that falls back on it.
+  for (int k = 0; k < 2; k++) {
+    total++;
+    printf("T%i Testing...\n", total);
+
+    int t = test_nul_match(k == 0 ? "a|b" : "a(a|b)*b");
+
+    if (t == 1) {
+      printf("T%i is successful\n", total);
+      success++;
+      tests[total - 1] = 1;
+    } else {
+      printf("T%i has failed\n", total);
+      tests[total - 1] = 0;
+    }
+  }
+
   if (success == total) {
     printf("All tests were successful\n");
   } else {
@@ -136,5 +195,66 @@ void test() {
 int test_strings(const char *str, const char *regex, int expected_val) {
   printf("Testing string '%s' with regex '%s'...\n", str, regex);
   int val = evaluate_string(str, regex, 0);
+
+  struct regex *r = regex_compile(regex);
+
+  if (r == NULL)
+    return -1;
+
+  // the compiled handle must give the same answer on every reuse, and once
+  // the first match has warmed up the scratch arena no more heap calls
+  // should happen.
+  regex_alloc_stats stats;
+
+  for (int i = 0; i < 3; i++) {
+    if (regex_match(r, str, strlen(str)) != val) {
+      regex_free(r);
+      return -1;
+    }
+
+    regex_get_alloc_stats(r, &stats);
+
+    if (i > 0 && stats.match_heap_allocations != 0) {
+      regex_free(r);
+      return -1;
+    }
+  }
+
+  regex_free(r);
+  return val;
+}
+
+int test_nul_match(const char *regex) {
+  printf("Testing a string with a nul byte with regex '%s'...\n", regex);
+
+  // a cache of one state makes the lazy dfa give up right away.
+  regex_options options;
+  options.dfa_cache_size = 1;
+  options.full_dfa = 0;
+  options.dfa_state_limit = 0;
+  options.no_bit_parallel = 1;
+
+  struct regex *r = regex_compile_with_options(regex, &options, NULL);
+  arena *mem = new_arena(4096);
+  regex_stream *s = r != NULL ? regex_stream_new(r) : NULL;
+
+  const char str[] = "a\0b";
+  int len = sizeof(str) - 1;
+  int val = s != NULL && mem != NULL &&
+            evaluate_string_in_nfa(r->n, str + 1, 2, mem) == 0 &&
+            evaluate_string_in_nfa(r->n, str, len, mem) == 0 &&
+            regex_match(r, str, len) == 0;
+
+  if (s != NULL) {
+    for (int i = 0; i < len; i++)
+      regex_stream_feed(s, str + i, 1);
+
+    if (regex_stream_finish(s) != 0)
+      val = 0;
+  }
+
+  regex_stream_free(s);
+  free_arena(mem);
+  regex_free(r);
   return val;
 }
@@ -0,0 +1,137 @@
+#include "../src/regex.h"
+
+int test_teddy(const char *str, const char **literals, int count,
+               int engine);
+int naive_find(const char *str, const char **literals, int count,
+               int *literal);
+
+void test();
+
+int main() {
+  test();
+  return 0;
+}
+
+void test() {
+  printf("Testing teddy...\n");
+
+  int tests[20];
+  int total = 20;
+  int success = 0;
+
+  for (int i = 0; i < 20; i++)
+    tests[i] = -1;
+
+  const char *methods[] = {"GET", "PUT", "POST", "DELETE"};
+  const char *many[] = {"ab",  "cd",  "ef",   "gh",  "ij",  "kl",
+                        "mn",  "op",  "qr",   "st",  "uv",  "wx",
+                        "yz0", "123", "4567", "890", "zzz", "q"};
+
+  const char *tests_string_inputs[20];
+  const char **tests_literals[20];
+  int tests_counts[20];
+
+  for (int i = 0; i < 20; i++) {
+    tests_string_inputs[i] = "";
+    tests_literals[i] = methods;
+    tests_counts[i] = 4;
+  }
+
+  tests_string_inputs[0] = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxPOSTxx";
+  tests_string_inputs[1] = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx";
+  tests_string_inputs[2] = "DELETDELEGETPUT";
+  tests_string_inputs[3] = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxDELE";
+  tests_string_inputs[4] = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxDELETE";
+
+  // more literals than buckets share the buckets.
+  tests_string_inputs[5] = "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA4567";
+  tests_literals[5] = many;
+  tests_counts[5] = 18;
+
+  tests_string_inputs[6] = "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAq";
+  tests_literals[6] = many;
+  tests_counts[6] = 18;
+
+  for (int i = 0; i < 20; i++) {
+    if (strlen(tests_string_inputs[i]) == 0) {
+      total--;
+      continue;
+    }
+
+    printf("T%i Testing...\n", i + 1);
+
+    // every engine the cpu has must agree with a plain search
+    int t = 1;
+
+    for (int engine = TEDDY_SCALAR; engine <= teddy_best_engine(); engine++) {
+      if (!test_teddy(tests_string_inputs[i], tests_literals[i],
+                      tests_counts[i], engine))
+        t = 0;
+    }
+
+    if (t == 1) {
+      printf("T%i is successful\n", i + 1);
+      success++;
+      tests[i] = 1;
+    } else {
+      printf("T%i has failed\n", i + 1);
+      tests[i] = 0;
+    }
+  }
+
+  if (success == total) {
+    printf("All tests were successful\n");
+  } else {
+    printf("Some tests are failed:\n");
+    for (int i = 0; i < 20; i++) {
+      if (tests[i] == 0)
+        printf("  T%i  ", i + 1);
+    }
+
+    printf("\n");
+  }
+
+  printf("Finish testing teddy\n\n");
+}
+
+int test_teddy(const char *str, const char **literals, int count,
+               int engine) {
+  printf("Searching string '%s' for %i literals with engine %i...\n", str,
+         count, engine);
+
+  int lens[20];
+
+  for (int i = 0; i < count; i++)
+    lens[i] = strlen(literals[i]);
+
+  teddy *t = new_teddy(literals, lens, count, NULL);
+
+  if (t == NULL)
+    return 0;
+
+  t->engine = engine;
+
+  int literal = -1;
+  int expected_literal = -1;
+  int at = teddy_find(t, str, strlen(str), &literal);
+  int expected_at = naive_find(str, literals, count, &expected_literal);
+
+  free_teddy(t);
+
+  return at == expected_at &&
+         (at == -1 || strncmp(str + at, literals[literal], lens[literal]) == 0);
+}
+
+int naive_find(const char *str, const char **literals, int count,
+               int *literal) {
+  for (int i = 0; str[i] != '\0'; i++) {
+    for (int k = 0; k < count; k++) {
+      if (strncmp(str + i, literals[k], strlen(literals[k])) == 0) {
+        *literal = k;
+        return i;
+      }
+    }
+  }
+
+  return -1;
+}